@@ -24,6 +24,7 @@
 
 #include <utility>
 #include <memory>
+#include <new>
 #include <type_traits>
 #include "cpp_version.hpp"
 #include "type_traits.hpp"
@@ -175,11 +176,11 @@ namespace ljh
 		{
 			if (rhs.has_val)
 			{
-				val = rhs.val;
+				new (&val) val_t(rhs.val);
 			}
 			else
 			{
-				unex = rhs.unex;
+				new (&unex) err_t(rhs.unex);
 			}
 		}
 
@@ -189,13 +190,11 @@ namespace ljh
 		{
 			if (rhs.has_val)
 			{
-				val = std::move(rhs.val);
-				rhs.val.~val_t();
+				new (&val) val_t(std::move(rhs.val));
 			}
 			else
 			{
-				unex = std::move(rhs.unex);
-				rhs.unex.~err_t();
+				new (&unex) err_t(std::move(rhs.unex));
 			}
 		}
 
@@ -236,11 +235,11 @@ namespace ljh
 			has_val = rhs.has_val;
 			if (rhs.has_val)
 			{
-				val = rhs.val;
+				new (&val) val_t(rhs.val);
 			}
 			else
 			{
-				unex = rhs.unex;
+				new (&unex) err_t(rhs.unex);
 			}
 			return *this;
 		}
@@ -258,11 +257,11 @@ namespace ljh
 			has_val = rhs.has_val;
 			if (rhs.has_val)
 			{
-				val = std::move(rhs.val);
+				new (&val) val_t(std::move(rhs.val));
 			}
 			else
 			{
-				unex = std::move(rhs.unex);
+				new (&unex) err_t(std::move(rhs.unex));
 			}
 			return *this;
 		}
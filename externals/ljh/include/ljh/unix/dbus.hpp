@@ -28,6 +28,7 @@
 #include <stdexcept>
 
 #include <cstring>
+#include <utility>
 
 #include <ljh/type_traits.hpp>
 #include <ljh/casting.hpp>
@@ -224,6 +225,9 @@ namespace ljh::unix::dbus
 		connection() = default;
 
 		connection(bus type);
+		// Takes over a reference the caller already holds, from
+		// dbus_bus_get_private say.
+		explicit connection(DBusConnection* adopt);
 		~connection();
 
 		connection(const connection& other);
@@ -255,6 +259,9 @@ namespace ljh::unix::dbus
 		interface() = default;
 
 		message call(std::string method);
+		// org.freedesktop.DBus.Properties.GetAll for this interface, read the
+		// reply into a std::map<std::string, std::variant<...>>.
+		message get_all();
 
 		template<typename T>
 		T get(std::string property);
@@ -293,7 +300,7 @@ namespace ljh::unix::dbus
 				char req = _i_type_value<std::variant_alternative_t<i, T>>;
 				if (cur == req)
 				{
-					auto& temp = std::get<i>(data);
+					auto& temp = data.template emplace<i>();
 					_this.get(item, temp);
 				}
 			}
@@ -393,19 +400,63 @@ namespace ljh::unix::dbus
 		error do_call()
 		{
 			error pending;
-			auto temp = dbus_connection_send_with_reply_and_block(base._connection, _message, DBUS_TIMEOUT_INFINITE, (DBusError*)pending);
+			DBusMessage* temp = nullptr;
+			if (_pending != nullptr)
+			{
+				dbus_pending_call_block(_pending);
+				temp = dbus_pending_call_steal_reply(_pending);
+				dbus_pending_call_unref(_pending);
+				_pending = nullptr;
+				if (temp == nullptr)
+					dbus_set_error((DBusError*)pending, DBUS_ERROR_NO_REPLY, "No reply received");
+			}
+			else
+			{
+				temp = dbus_connection_send_with_reply_and_block(base._connection, _message, DBUS_TIMEOUT_INFINITE, (DBusError*)pending);
+			}
 			dbus_message_unref(_message);
 			_message = temp;
 			return pending;
 		}
 
+		DBusPendingCall* _pending = nullptr;
+
 	public:
+		// Wraps a message received from the bus, a signal say, so read() can
+		// take it apart. Takes a reference of its own.
+		message(const interface& base, DBusMessage* received);
+
+		message(message&& other)
+			: base(other.base)
+			, _message(std::exchange(other._message, nullptr))
+			, _pending(std::exchange(other._pending, nullptr))
+		{}
+
 		~message()
 		{
+			if (_pending != nullptr)
+			{
+				dbus_pending_call_cancel(_pending);
+				dbus_pending_call_unref(_pending);
+			}
 			if (_message != nullptr)
 				dbus_message_unref(_message);
 		}
 
+		// Queues the call without waiting for its reply, run() then waits for
+		// and reads it. Sending several before running any of them has them
+		// all in flight at once.
+		message& send()
+		{
+			if (!dbus_connection_send_with_reply(base._connection, _message, &_pending, DBUS_TIMEOUT_USE_DEFAULT) || _pending == nullptr)
+			{
+				error err;
+				dbus_set_error((DBusError*)err, DBUS_ERROR_DISCONNECTED, "Could not send message");
+				throw err;
+			}
+			return *this;
+		}
+
 		std::string signature() const
 		{
 			return dbus_message_get_signature(_message);
@@ -430,6 +481,12 @@ namespace ljh::unix::dbus
 			if (dbus_set_error_from_message((DBusError*)err, _message))
 				throw err;
 
+			read(args...);
+		}
+
+		template<typename... A>
+		void read(A&... args)
+		{
 			DBusMessageIter iter;
 			dbus_message_iter_init(_message, &iter);
 			expand_type{(get(iter, args), 0)...};
@@ -440,7 +497,12 @@ namespace ljh::unix::dbus
 		{
 			if constexpr (std::is_void_v<A>)
 			{
-				do_call();
+				auto pending = do_call();
+				if (pending) throw pending;
+
+				error err;
+				if (dbus_set_error_from_message((DBusError*)err, _message))
+					throw err;
 			}
 			else
 			{
@@ -514,7 +576,7 @@ namespace ljh::unix::dbus
 		{
 			DBusMessageIter sub;
 			dbus_message_iter_recurse(&item, &sub);
-			do
+			if (dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_INVALID) do
 			{
 				DBusMessageIter member;
 				dbus_message_iter_recurse(&sub, &member);
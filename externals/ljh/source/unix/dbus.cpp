@@ -59,22 +59,34 @@ ljh::unix::dbus::connection::connection(bus type)
 	if (_error) throw _error;
 }
 
+ljh::unix::dbus::connection::connection(DBusConnection* adopt)
+	: data(adopt)
+{}
+
 ljh::unix::dbus::connection::~connection()
 {
-	dbus_connection_unref(data);
+	if (data != nullptr)
+		dbus_connection_unref(data);
 	data = nullptr;
 }
 
 ljh::unix::dbus::connection::connection(const connection& other)
 {
 	data = other.data;
-	dbus_connection_ref(data);
+	if (data != nullptr)
+		dbus_connection_ref(data);
 }
 
 ljh::unix::dbus::connection& ljh::unix::dbus::connection::operator=(const connection& other)
 {
-	data = other.data;
-	dbus_connection_ref(data);
+	if (this != &other)
+	{
+		if (data != nullptr)
+			dbus_connection_unref(data);
+		data = other.data;
+		if (data != nullptr)
+			dbus_connection_ref(data);
+	}
 	return *this;
 }
 
@@ -86,8 +98,13 @@ ljh::unix::dbus::connection::connection(connection&& other)
 
 ljh::unix::dbus::connection& ljh::unix::dbus::connection::operator=(connection&& other)
 {
-	data = other.data;
-	other.data = nullptr;
+	if (this != &other)
+	{
+		if (data != nullptr)
+			dbus_connection_unref(data);
+		data = other.data;
+		other.data = nullptr;
+	}
 	return *this;
 }
 
@@ -125,11 +142,23 @@ ljh::unix::dbus::message ljh::unix::dbus::interface::get(std::string property)
 	return temp;
 }
 
+ljh::unix::dbus::message ljh::unix::dbus::interface::get_all()
+{
+	message temp{*this, DBUS_INTERFACE_PROPERTIES, "GetAll"};
+	temp.args(_interface);
+	return temp;
+}
+
 ljh::unix::dbus::message::message(const interface& base, std::string interface, std::string method)
 	: base(base)
 {
 	_message = dbus_message_new_method_call(base.server.c_str(), base.path.c_str(), interface.c_str(), method.c_str());
 }
 
+ljh::unix::dbus::message::message(const interface& base, DBusMessage* received)
+	: base(base)
+	, _message(dbus_message_ref(received))
+{}
+
 
 
@@ -31,7 +31,8 @@ Bakaneko::System get_system_info(asio::ip::tcp::socket& socket, const std::strin
     beast::http::request<beast::http::string_body> req{beast::http::verb::get, "/system", 11};
 
     req.set(beast::http::field::host, ip_address);
-    req.set(beast::http::field::content_type, "application/x-protobuf");
+    req.set(beast::http::field::content_type, "application/json");
+    req.set(beast::http::field::accept, accepted_formats);
     req.version(11);
 
     beast::http::write(socket, req, ec);
@@ -46,7 +47,7 @@ Bakaneko::System get_system_info(asio::ip::tcp::socket& socket, const std::strin
     if (ec) return info;
     if (res.result_int() != 200) return info;
 
-    info = json::parse(res.body());
+    info = parse_body(res);
     return info;
 }
 
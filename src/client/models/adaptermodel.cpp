@@ -54,6 +54,14 @@ QVariant AdapterModel::data(const QModelIndex& index, int role) const
     if (role == ROLE_mac_address) return QVariant::fromValue(QString::fromStdString(temp.mac_address));
     if (role == ROLE_ip_address ) return QVariant::fromValue(QString::fromStdString(temp.ip_address ));
 
+    if (role == ROLE_addresses)
+    {
+        QStringList addresses;
+        for (auto& address : temp.addresses)
+            addresses.push_back(QString::fromStdString(address));
+        return QVariant::fromValue(addresses);
+    }
+
     if (role == ROLE_link_speed)
     {
         if (temp.link_speed == 0)
@@ -66,7 +74,14 @@ QVariant AdapterModel::data(const QModelIndex& index, int role) const
         return QVariant::fromValue(QString::fromStdString(temp.state == Bakaneko::Adapter::State::Up ? "Up" : "Down"));
     }
 
-    
+    // Servers that sample their adapters send the rates along, the same
+    // ones every client sees. Otherwise they come from the last two polls.
+    if (temp.interval != 0)
+    {
+        if (role == ROLE_rx_rate) return QVariant::fromValue(QString::fromStdString(bitrate_to_string(temp.rx_rate * 8)));
+        if (role == ROLE_tx_rate) return QVariant::fromValue(QString::fromStdString(bitrate_to_string(temp.tx_rate * 8)));
+    }
+
     auto& prec = prevous[row];
     auto delta_time = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::nanoseconds(temp.time - prec.time));
 
@@ -105,6 +120,7 @@ QHash<int, QByteArray> AdapterModel::roleNames() const
     roles[ROLE_mtu        ] = "mtu";
     roles[ROLE_mac_address] = "mac_address";
     roles[ROLE_ip_address ] = "ip_address";
+    roles[ROLE_addresses  ] = "addresses";
     roles[ROLE_rx_rate    ] = "rx_rate";
     roles[ROLE_tx_rate    ] = "tx_rate";
     return roles;
@@ -21,6 +21,7 @@ public:
         ROLE_mtu,
         ROLE_mac_address,
         ROLE_ip_address,
+        ROLE_addresses,
         ROLE_rx_rate,
         ROLE_tx_rate,
     };
@@ -7,6 +7,8 @@
 
 #include <QSettings>
 
+#include <KLocalizedString>
+
 #include <objects/server.h>
 
 DrivesModel::DrivesModel(QObject* parent)
@@ -127,6 +129,7 @@ QVariant PartitionModel::data(const QModelIndex& index, int role) const
 
     if (role == ROLE_dev_node  ) return QVariant::fromValue(QString::fromStdString(                      temp.dev_node                              )      );
     if (role == ROLE_size      ) return QVariant::fromValue(QString::fromStdString(bytes_to_string<1000>(temp.size                          )       )      );
+    if (role == ROLE_used && !temp.available) return QVariant::fromValue(i18n("Unavailable"));
     if (role == ROLE_used      ) return QVariant::fromValue(QString::number       (               (int)((temp.used       / (double)temp.size) * 100)) + "%");
     if (role == ROLE_mountpoint) return QVariant::fromValue(QString::fromStdString(                      temp.mountpoint                            )      );
     if (role == ROLE_filesystem) return QVariant::fromValue(QString::fromStdString(                      temp.filesystem                            )      );
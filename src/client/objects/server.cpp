@@ -12,6 +12,8 @@
 #include <iostream>
 #include <string_view>
 #include <thread>
+#include <optional>
+#include <algorithm>
 #include <iostream>
 
 #include "managers/servermanager.h"
@@ -24,6 +26,7 @@
 
 #include "windows.hpp"
 #include "base64.hpp"
+#include "compression.hpp"
 #include "bakaneko-version.h"
 
 #if defined(_WIN32)
@@ -92,11 +95,15 @@ void Server::update_info()
         {
             steps_done.count_down();
             steps_done.count_down();
-            
-            if (avaliable_adapters) network_get("/drives"          , &Server::got_drives  ); else steps_done.count_down();
-            if (avaliable_drives  ) network_get("/updates"         , &Server::got_updates ); else steps_done.count_down();
-            if (avaliable_updates ) network_get("/network/adapters", &Server::got_adapters); else steps_done.count_down();
-            if (avaliable_services) network_get("/services"        , &Server::got_services); else steps_done.count_down();
+
+            std::vector<std::string> sections;
+            // Whatever is live on the stream is already up to date.
+            if (avaliable_drives   && !live_drives  ) sections.push_back("drives"          ); else steps_done.count_down();
+            if (avaliable_updates                   ) sections.push_back("updates"         ); else steps_done.count_down();
+            if (avaliable_adapters && !live_adapters) sections.push_back("network/adapters"); else steps_done.count_down();
+            if (avaliable_services && !live_services) sections.push_back("services"        ); else steps_done.count_down();
+            network_batch(std::move(sections));
+            network_stream();
         }
         else
         {
@@ -120,8 +127,16 @@ void Server::update_info()
     state = new_state;
     Q_EMIT changed_state();
 
+    // Coming back online always starts from full responses.
+    {
+        std::lock_guard guard{etags_lock};
+        etags.clear();
+    }
+
     if (new_state == State::Offline)
     {
+        close_stream();
+
         if (hostname != defualt_hostname)
         {
             hostname = defualt_hostname;
@@ -141,11 +156,8 @@ void Server::update_info()
         return;
     }
 
-    network_get("/system"          , &Server::got_info                        );
-    network_get("/service"         , &Server::got_service , avaliable_services);
-    network_get("/drives"          , &Server::got_drives  , avaliable_drives  );
-    network_get("/updates"         , &Server::got_updates , avaliable_updates );
-    network_get("/network/adapters", &Server::got_adapters, avaliable_adapters);
+    network_batch({"system", "service", "services", "drives", "updates", "network/adapters"});
+    network_stream();
 }
 
 asio::ip::tcp::socket Server::connection()
@@ -157,6 +169,60 @@ asio::ip::tcp::socket Server::connection()
     return socket;
 }
 
+template<typename Request, typename Response>
+void Server::transfer(Request& req, Response& res)
+{
+    req.keep_alive(true);
+
+    for (int attempt = 0; ; attempt++)
+    {
+        std::optional<asio::ip::tcp::socket> channel;
+        if (attempt == 0)
+        {
+            std::lock_guard guard{channels_lock};
+            if (!channels.empty())
+            {
+                channel.emplace(std::move(channels.back()));
+                channels.pop_back();
+            }
+        }
+
+        bool reused = channel.has_value();
+        if (!reused)
+            channel.emplace(connection());
+
+        bool written = false;
+        try
+        {
+            beast::flat_buffer buffer;
+            res = {};
+            beast::http::write(*channel, req);
+            written = true;
+            beast::http::read(*channel, buffer, res);
+        }
+        catch (const boost::system::system_error&)
+        {
+            // The server drops connections that sit idle for too long, so a
+            // reused one failing just means it has to be opened again. Once
+            // the request went out, only what can safely run twice is sent
+            // again, the server may have acted on the rest before the
+            // answer got lost.
+            auto idempotent = req.method() == beast::http::verb::get || req.method() == beast::http::verb::head;
+            if (reused && (!written || idempotent))
+                continue;
+            throw;
+        }
+
+        if (res.keep_alive())
+        {
+            std::lock_guard guard{channels_lock};
+            if (channels.size() < max_steps)
+                channels.push_back(std::move(*channel));
+        }
+        return;
+    }
+}
+
 Server::State Server::ping_computer()
 {
     try
@@ -166,16 +232,9 @@ Server::State Server::ping_computer()
         req.set(beast::http::field::host, ip_address);
         req.set(beast::http::field::user_agent, "Bakaneko/" BAKANEKO_VERSION_STRING);
         req.version(11);
-        req.keep_alive(true);
-
-        auto channel = connection();
-
-        beast::http::write(channel, req);
 
-        beast::flat_buffer buffer;
         beast::http::response<beast::http::empty_body> res;
-
-        beast::http::read(channel, buffer, res);
+        transfer(req, res);
 
         if (res.result_int() == 302)
             return Server::State::Online;
@@ -197,12 +256,17 @@ Server::Server(std::string hostname, std::string mac_address, std::string ip_add
     , steps_done      {          0}
 {
     state = State::Unknown;
+    stream_pool.setMaxThreadCount(1);
     connect(this, &Server::got_info    , this, &Server::handle_info    );
     connect(this, &Server::got_drives  , this, &Server::handle_drives  );
     connect(this, &Server::got_updates , this, &Server::handle_updates );
     connect(this, &Server::got_adapters, this, &Server::handle_adapters);
     connect(this, &Server::got_service , this, &Server::handle_service );
     connect(this, &Server::got_services, this, &Server::handle_services);
+
+    connect(this, &Server::streamed_drives  , this, &Server::apply_drives  );
+    connect(this, &Server::streamed_adapters, this, &Server::apply_adapters);
+    connect(this, &Server::streamed_services, this, &Server::apply_services);
 }
 
 void Server::wake_up()
@@ -275,22 +339,15 @@ void Server::network_get(std::string path, void(Server::*signal)(T), bool& contr
     QtConcurrent::run([this, path, signal, &control]{
         try
         {
-            beast::http::request<beast::http::string_body> req{beast::http::verb::get, path, 11};
-
-            req.set(beast::http::field::host, ip_address);
-            req.set(beast::http::field::user_agent, "Bakaneko/" BAKANEKO_VERSION_STRING);
-            req.set(beast::http::field::content_type, "application/json");
-            req.version(11);
-            req.keep_alive(false);
-
-            auto channel = connection();
-
-            beast::http::write(channel, req);
-
-            beast::flat_buffer buffer;
             beast::http::response<beast::http::string_body> res;
 
-            beast::http::read(channel, buffer, res);
+            // Nothing changed since the last poll, so there is nothing to
+            // parse or hand to the models.
+            if (!network_fetch(path, res))
+            {
+                steps_done.count_down();
+                return;
+            }
             
             T info;
 
@@ -303,7 +360,7 @@ void Server::network_get(std::string path, void(Server::*signal)(T), bool& contr
                 Q_EMIT changed_enabled_pages();
             }
 
-            info = json::parse(res.body());
+            info = parse_body(res);
             Q_EMIT (*this.*signal)(info);
         }
         catch (std::exception e)
@@ -333,6 +390,257 @@ void Server::network_get(std::string path, void(Server::*signal)(T), bool& contr
     });
 }
 
+bool Server::network_fetch(const std::string& path, beast::http::response<beast::http::string_body>& res)
+{
+    beast::http::request<beast::http::string_body> req{beast::http::verb::get, path, 11};
+
+    req.set(beast::http::field::host, ip_address);
+    req.set(beast::http::field::user_agent, "Bakaneko/" BAKANEKO_VERSION_STRING);
+    req.set(beast::http::field::content_type, "application/json");
+    req.set(beast::http::field::accept, accepted_formats);
+    req.set(beast::http::field::accept_encoding, "gzip, deflate");
+    req.version(11);
+
+    {
+        std::lock_guard guard{etags_lock};
+        if (auto etag = etags.find(path); etag != etags.end())
+            req.set(beast::http::field::if_none_match, etag->second);
+    }
+
+    transfer(req, res);
+
+    if (res.result() == beast::http::status::not_modified)
+        return false;
+    if (res.result() != beast::http::status::ok)
+        return true;
+
+    if (auto encoding = res.find(beast::http::field::content_encoding); encoding != res.end())
+    {
+        if (Compression::from_name({encoding->value().data(), encoding->value().size()}) != Compression::Encoding::Identity)
+            res.body() = Compression::decompress(res.body());
+    }
+
+    if (auto etag = res.find(beast::http::field::etag); etag != res.end())
+    {
+        std::lock_guard guard{etags_lock};
+        etags[path] = std::string{etag->value().data(), etag->value().size()};
+    }
+    return true;
+}
+
+void Server::network_batch(std::vector<std::string> sections)
+{
+    if (sections.empty())
+        return;
+    if (!batch_supported)
+        return network_sections(sections);
+
+    QtConcurrent::run([this, sections = std::move(sections)]{
+        std::string path = "/batch?sections=";
+        for (auto& section : sections)
+        {
+            if (&section != &sections.front())
+                path += ',';
+            path += section;
+        }
+
+        Bakaneko::Batch batch;
+        try
+        {
+            beast::http::response<beast::http::string_body> res;
+            if (!network_fetch(path, res))
+            {
+                for (auto& section : sections)
+                    steps_done.count_down();
+                return;
+            }
+
+            // Server from before /batch existed.
+            if (res.result() == beast::http::status::not_found)
+            {
+                batch_supported = false;
+                return network_sections(sections);
+            }
+
+            if (res.result() != beast::http::status::ok) throw res.result();
+
+            batch = parse_body(res);
+        }
+        catch (...)
+        {
+            for (auto& section : sections)
+                steps_done.count_down();
+            return;
+        }
+
+        using Status = Bakaneko::Batch::Section::Status;
+
+        // Every requested section counts the latch down once, either through
+        // its handle_* slot or here when there is nothing to hand over.
+        auto remaining = sections;
+        for (auto& section : batch.sections)
+        {
+            auto item = std::find(remaining.begin(), remaining.end(), section.name);
+            if (item == remaining.end())
+                continue;
+            remaining.erase(item);
+
+            bool ok = section.status == Status::OK;
+
+            bool* control = nullptr;
+            if      (section.name == "service"         ) control = &avaliable_services;
+            else if (section.name == "drives"          ) control = &avaliable_drives  ;
+            else if (section.name == "updates"         ) control = &avaliable_updates ;
+            else if (section.name == "network/adapters") control = &avaliable_adapters;
+
+            if (control != nullptr && section.status != Status::Failed && *control != ok)
+            {
+                *control = ok;
+                Q_EMIT changed_enabled_pages();
+            }
+
+            if (!ok)
+                steps_done.count_down();
+            else if (section.name == "system"          ) Q_EMIT got_info    (batch.system  );
+            else if (section.name == "service"         ) Q_EMIT got_service (batch.service );
+            else if (section.name == "services"        ) Q_EMIT got_services(batch.services);
+            else if (section.name == "drives"          ) Q_EMIT got_drives  (batch.drives  );
+            else if (section.name == "updates"         ) Q_EMIT got_updates (batch.updates );
+            else if (section.name == "network/adapters") Q_EMIT got_adapters(batch.adapters);
+            else steps_done.count_down();
+        }
+
+        for (auto& section : remaining)
+            steps_done.count_down();
+    });
+}
+
+void Server::network_sections(const std::vector<std::string>& sections)
+{
+    for (auto& section : sections)
+    {
+        if      (section == "system"          ) network_get("/system"          , &Server::got_info                        );
+        else if (section == "service"         ) network_get("/service"         , &Server::got_service , avaliable_services);
+        else if (section == "services"        ) network_get("/services"        , &Server::got_services                    );
+        else if (section == "drives"          ) network_get("/drives"          , &Server::got_drives  , avaliable_drives  );
+        else if (section == "updates"         ) network_get("/updates"         , &Server::got_updates , avaliable_updates );
+        else if (section == "network/adapters") network_get("/network/adapters", &Server::got_adapters, avaliable_adapters);
+        else steps_done.count_down();
+    }
+}
+
+void Server::network_stream()
+{
+    if (!stream_supported || stream_task.isRunning())
+        return;
+
+    stream_task = QtConcurrent::run(&stream_pool, [this]{
+        beast::websocket::stream<asio::ip::tcp::socket> ws{ioctx};
+
+        // Local copy of every record pushed so far, the models are handed
+        // the whole section after each change just like after a poll.
+        std::map<std::string, Bakaneko::Drive  > drive_records;
+        std::map<std::string, Bakaneko::Adapter> adapter_records;
+        std::map<std::string, Bakaneko::Service> service_records;
+
+        auto apply = [](auto& records, auto& changes, auto key) {
+            if (changes.full)
+                records.clear();
+            for (auto& id : changes.removed)
+                records.erase(id);
+            for (auto& record : changes.changed)
+                records.insert_or_assign(record.*key, std::move(record));
+        };
+
+        try
+        {
+            ws.next_layer() = connection();
+            {
+                std::lock_guard guard{stream_lock};
+                stream_socket = &ws.next_layer();
+            }
+
+            ws.set_option(beast::websocket::stream_base::decorator([](beast::websocket::request_type& req) {
+                req.set(beast::http::field::user_agent, "Bakaneko/" BAKANEKO_VERSION_STRING);
+            }));
+            ws.handshake(ip_address, "/stream");
+
+            ws.text(true);
+            ws.write(asio::buffer(json(Bakaneko::StreamRequest{{"drives", "network/adapters", "services"}}).dump()));
+
+            beast::flat_buffer buffer;
+            for (;;)
+            {
+                buffer.clear();
+                ws.read(buffer);
+
+                auto message = json::parse(beast::buffers_to_string(buffer.data()));
+                auto section = message.at("section").get<std::string>();
+                if (section == "drives")
+                {
+                    auto changes = message.get<Bakaneko::DriveChanges>();
+                    apply(drive_records, changes, &Bakaneko::Drive::dev_node);
+
+                    Bakaneko::Drives info;
+                    for (auto& [id, record] : drive_records)
+                        info.drives.push_back(record);
+                    live_drives = true;
+                    Q_EMIT streamed_drives(std::move(info));
+                }
+                else if (section == "network/adapters")
+                {
+                    auto changes = message.get<Bakaneko::AdapterChanges>();
+                    apply(adapter_records, changes, &Bakaneko::Adapter::name);
+
+                    Bakaneko::Adapters info;
+                    for (auto& [id, record] : adapter_records)
+                        info.adapters.push_back(record);
+                    live_adapters = true;
+                    Q_EMIT streamed_adapters(std::move(info));
+                }
+                else if (section == "services")
+                {
+                    auto changes = message.get<Bakaneko::ServiceChanges>();
+                    apply(service_records, changes, &Bakaneko::Service::id);
+
+                    Bakaneko::Services info;
+                    for (auto& [id, record] : service_records)
+                        info.services.push_back(record);
+                    live_services = true;
+                    Q_EMIT streamed_services(std::move(info));
+                }
+            }
+        }
+        catch (const boost::system::system_error& e)
+        {
+            // Server from before /stream existed, it answers with a 404.
+            if (e.code() == beast::websocket::error::upgrade_declined)
+                stream_supported = false;
+        }
+        catch (...)
+        {
+        }
+
+        // Back to polling everything until the next stream is up.
+        live_drives   = false;
+        live_adapters = false;
+        live_services = false;
+
+        std::lock_guard guard{stream_lock};
+        stream_socket = nullptr;
+    });
+}
+
+void Server::close_stream()
+{
+    std::lock_guard guard{stream_lock};
+    if (stream_socket != nullptr)
+    {
+        boost::system::error_code ec;
+        stream_socket->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    }
+}
+
 template<typename T, typename F>
 void Server::network_post(std::string path, T data, std::string auth, void(Server::*suc)(), void(Server::*fai)(F))
 {
@@ -343,20 +651,24 @@ void Server::network_post(std::string path, T data, std::string auth, void(Serve
 
             req.set(beast::http::field::host, ip_address);
             req.set(beast::http::field::user_agent, "Bakaneko/" BAKANEKO_VERSION_STRING);
-            req.set(beast::http::field::authorization, auth);
+            auto authorization = session_authorization(auth);
+            req.set(beast::http::field::authorization, authorization);
             req.version(11);
-            req.keep_alive(false);
             req.body() = json(data).dump();
             req.prepare_payload();
 
-            auto channel = connection();
-
-            beast::http::write(channel, req);
-
-            beast::flat_buffer buffer;
             beast::http::response<beast::http::string_body> res;
+            transfer(req, res);
 
-            beast::http::read(channel, buffer, res);
+            // The token is gone when the server restarted or the password
+            // changed, the password gets one more go.
+            if (res.result() == beast::http::status::unauthorized && authorization != auth)
+            {
+                forget_session();
+                req.set(beast::http::field::authorization, session_authorization(auth));
+                res = {};
+                transfer(req, res);
+            }
 
             if (res.result_int() != 200) {
                 Q_EMIT (*this.*fai)("An error happened");
@@ -365,12 +677,60 @@ void Server::network_post(std::string path, T data, std::string auth, void(Serve
 
             Q_EMIT (*this.*suc)();
         }
+        catch (const boost::system::system_error&)
+        {
+            // Not sent again by transfer(), the server may or may not have
+            // acted on it.
+            Q_EMIT (*this.*fai)("Lost the connection to the server");
+        }
         catch (...)
         {
         }
     });
 }
 
+std::string Server::session_authorization(const std::string& basic)
+{
+    {
+        std::lock_guard guard{session_lock};
+        if (session_basic == basic && std::chrono::steady_clock::now() < session_expiry)
+            return "Bearer " + session_token;
+    }
+
+    beast::http::request<beast::http::empty_body> req{beast::http::verb::post, "/session", 11};
+
+    req.set(beast::http::field::host, ip_address);
+    req.set(beast::http::field::user_agent, "Bakaneko/" BAKANEKO_VERSION_STRING);
+    req.set(beast::http::field::content_type, "application/json");
+    req.set(beast::http::field::accept, accepted_formats);
+    req.set(beast::http::field::authorization, basic);
+    req.version(11);
+
+    beast::http::response<beast::http::string_body> res;
+    transfer(req, res);
+
+    // Servers from before sessions answer 404. A wrong password is left for
+    // the request itself to report.
+    if (res.result() != beast::http::status::ok)
+        return basic;
+
+    Bakaneko::Session session = parse_body(res);
+
+    std::lock_guard guard{session_lock};
+    session_basic = basic;
+    session_token = session.token;
+    // A little early, so it doesn't run out on the way there.
+    session_expiry = std::chrono::steady_clock::now() + std::chrono::seconds{session.expires_in} - std::chrono::seconds{10};
+    return "Bearer " + session_token;
+}
+
+void Server::forget_session()
+{
+    std::lock_guard guard{session_lock};
+    session_basic.clear();
+    session_token.clear();
+}
+
 void Server::network_post(std::string path)
 {
     QtConcurrent::run([this, path]{
@@ -381,11 +741,9 @@ void Server::network_post(std::string path)
             req.set(beast::http::field::host, ip_address);
             req.set(beast::http::field::user_agent, "Bakaneko/" BAKANEKO_VERSION_STRING);
             req.version(11);
-            req.keep_alive(false);
-
-            auto channel = connection();
 
-            beast::http::write(channel, req);
+            beast::http::response<beast::http::empty_body> res;
+            transfer(req, res);
         }
         catch (...)
         {
@@ -435,6 +793,12 @@ void Server::handle_updates(Bakaneko::Updates updates_info)
 }
 
 void Server::handle_drives(Bakaneko::Drives info)
+{
+    apply_drives(std::move(info));
+    steps_done.count_down();
+}
+
+void Server::apply_drives(Bakaneko::Drives info)
 {
     std::vector vinfo(info.drives.begin(), info.drives.end());
 
@@ -498,6 +862,11 @@ void Server::handle_drives(Bakaneko::Drives info)
                     pdata.filesystem = (pinfo.filesystem);
                     partitions.flag(a, { PartitionModel::ROLE_filesystem });
                 }
+                if (pdata.available != pinfo.available)
+                {
+                    pdata.available = (pinfo.available);
+                    partitions.flag(a, { PartitionModel::ROLE_used });
+                }
             }
         }
     };
@@ -533,11 +902,15 @@ void Server::handle_drives(Bakaneko::Drives info)
             update_partitions(drives.rowCount() - 1, dinfo);
         }
     }
+}
 
+void Server::handle_adapters(Bakaneko::Adapters info)
+{
+    apply_adapters(std::move(info));
     steps_done.count_down();
 }
 
-void Server::handle_adapters(Bakaneko::Adapters info)
+void Server::apply_adapters(Bakaneko::Adapters info)
 {
     for (int a = 0; a < adapters.rowCount(); a++)
     {
@@ -567,11 +940,18 @@ void Server::handle_adapters(Bakaneko::Adapters info)
                 cur.bytes_rx   = (din.bytes_rx  );
                 cur.bytes_tx   = (din.bytes_tx  );
                 cur.time       = (din.time      );
+                cur.rx_rate    = (din.rx_rate   );
+                cur.tx_rate    = (din.tx_rate   );
+                cur.interval   = (din.interval  );
                 cur.state      = (din.state     );
                 cur.link_speed = (din.link_speed);
+                cur.ip_address = (din.ip_address);
+                cur.addresses  = (din.addresses );
                 adapters.flag(a,{
                     AdapterModel::ROLE_link_speed,
                     AdapterModel::ROLE_state,
+                    AdapterModel::ROLE_ip_address,
+                    AdapterModel::ROLE_addresses,
                     AdapterModel::ROLE_rx_rate,
                     AdapterModel::ROLE_tx_rate,
                 });
@@ -593,13 +973,12 @@ void Server::handle_adapters(Bakaneko::Adapters info)
                 AdapterModel::ROLE_mtu,
                 AdapterModel::ROLE_mac_address,
                 AdapterModel::ROLE_ip_address,
+                AdapterModel::ROLE_addresses,
                 AdapterModel::ROLE_rx_rate,
                 AdapterModel::ROLE_tx_rate,
             });
         }
     }
-
-    steps_done.count_down();
 }
 
 void Server::shutdown()
@@ -616,6 +995,9 @@ Server::~Server()
 {
     boost::system::error_code ec;
     socket.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+
+    close_stream();
+    stream_task.waitForFinished();
 }
 
 void Server::open_term(LoginData* login)
@@ -695,11 +1077,15 @@ void Server::handle_service(Bakaneko::ServiceInfo info)
     }
 
     steps_done.count_down();
-
-    network_get("/services", &Server::got_services);
 }
 
 void Server::handle_services(Bakaneko::Services info)
+{
+    apply_services(std::move(info));
+    steps_done.count_down();
+}
+
+void Server::apply_services(Bakaneko::Services info)
 {
     for (int a = 0; a < services.rowCount(); a++)
     {
@@ -754,8 +1140,6 @@ void Server::handle_services(Bakaneko::Services info)
             }, {});
         }
     }
-
-    steps_done.count_down();
 }
 
 void Server::control_service(LoginData* login, QString id, int action)
@@ -5,12 +5,17 @@
 
 #include <QObject>
 #include <QTimer>
+#include <QFuture>
+#include <QThreadPool>
 
 #include <memory>
 #include <mutex>
+#include <chrono>
+#include <atomic>
 #include <array>
 #include <vector>
 #include <string>
+#include <map>
 
 #include <libssh/libssh.h>
 
@@ -29,6 +34,8 @@
 #include "updates.hpp"
 #include "network.hpp"
 #include "services.hpp"
+#include "batch.hpp"
+#include "subscriptions.hpp"
 
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/connect.hpp>
@@ -36,6 +43,7 @@
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
+#include <boost/beast/websocket.hpp>
 
 #include <boost/thread/latch.hpp>
 
@@ -85,13 +93,32 @@ protected:
     void network_get(std::string path, void(Server::*signal)(T));
     template<typename T>
     void network_get(std::string path, void(Server::*signal)(T), bool& control);
+    bool network_fetch(const std::string& path, beast::http::response<beast::http::string_body>& res);
+    void network_batch(std::vector<std::string> sections);
+    void network_sections(const std::vector<std::string>& sections);
+    // Keeps a /stream WebSocket open in the background while the server is
+    // online, feeding adapter, service and drive changes to the models as
+    // they are pushed. Sections it delivers are left out of update_info().
+    void network_stream();
+    void close_stream();
     void network_post(std::string path);
     template<typename T, typename F>
     void network_post(std::string path, T data, std::string auth, void(Server::*suc)(), void(Server::*fai)(F));
+    // Trades the Basic authorization for a token from /session, which is
+    // reused until it runs out, so the server checks the password once per
+    // session instead of on every request. Returns basic as is when the
+    // server didn't hand one out.
+    std::string session_authorization(const std::string& basic);
+    void forget_session();
 
 public:
     asio::ip::tcp::socket connection();
 
+    // Sends the request over a kept-alive connection, opening one when none
+    // are free, and reads the reply into res.
+    template<typename Request, typename Response>
+    void transfer(Request& req, Response& res);
+
     static constexpr std::size_t max_steps = 6;
     boost::latch steps_done;
 
@@ -130,6 +157,10 @@ public Q_SLOTS:
     void handle_service (Bakaneko::ServiceInfo);
     void handle_services(Bakaneko::Services   );
 
+    void apply_drives  (Bakaneko::Drives  );
+    void apply_adapters(Bakaneko::Adapters);
+    void apply_services(Bakaneko::Services);
+
     void wake_up ();
     void shutdown();
     void reboot  ();
@@ -160,6 +191,10 @@ Q_SIGNALS:
     void got_service (Bakaneko::ServiceInfo);
     void got_services(Bakaneko::Services   );
 
+    void streamed_drives  (Bakaneko::Drives  );
+    void streamed_adapters(Bakaneko::Adapters);
+    void streamed_services(Bakaneko::Services);
+
     void this_online (Server*);
     void this_offline(Server*);
 
@@ -171,6 +206,38 @@ Q_SIGNALS:
 protected:
     asio::ip::tcp::socket socket;
 
+    // Idle keep-alive connections to the server, reused by transfer().
+    std::mutex channels_lock;
+    std::vector<asio::ip::tcp::socket> channels;
+
+    // ETag of the last response seen for each GET path.
+    std::mutex etags_lock;
+    std::map<std::string, std::string> etags;
+
+    // Cleared the first time the server answers /batch with a 404, after
+    // which refreshes go back to one request per section.
+    std::atomic<bool> batch_supported = true;
+
+    // The last session token and the Basic authorization it was given for,
+    // so logging in differently gets a new one.
+    std::mutex session_lock;
+    std::string session_basic;
+    std::string session_token;
+    std::chrono::steady_clock::time_point session_expiry;
+
+    // The /stream connection, if one is open. Cleared the first time the
+    // server declines the upgrade, like batch_supported.
+    std::mutex stream_lock;
+    asio::ip::tcp::socket* stream_socket = nullptr;
+    // The stream blocks a thread for as long as it is open, it gets its own
+    // so polls and controls on the global pool don't wait behind it.
+    QThreadPool stream_pool;
+    QFuture<void> stream_task;
+    std::atomic<bool> stream_supported = true;
+    std::atomic<bool> live_drives   = false;
+    std::atomic<bool> live_adapters = false;
+    std::atomic<bool> live_services = false;
+
     State state;
 
     std::string defualt_hostname;
@@ -202,6 +269,17 @@ Q_DECLARE_METATYPE(Bakaneko::Drives  );
 Q_DECLARE_METATYPE(Bakaneko::Updates );
 Q_DECLARE_METATYPE(Bakaneko::Adapters);
 
+// Sent as Accept on every GET. Servers that predate MessagePack ignore it
+// and answer in JSON because of the Content-Type that is sent as well.
+constexpr auto accepted_formats = "application/x-msgpack, application/json;q=0.5";
+
+inline nlohmann::json parse_body(const beast::http::response<beast::http::string_body>& res)
+{
+    if (res[beast::http::field::content_type] == "application/x-msgpack")
+        return nlohmann::json::from_msgpack(res.body());
+    return nlohmann::json::parse(res.body());
+}
+
 template<size_t factor = 1024>
 inline std::string bytes_to_string(uint64_t size)
 {
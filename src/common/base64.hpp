@@ -3,12 +3,12 @@
 
 #pragma once
 
-#include <string>
 #include <array>
-#include <bitset>
+#include <string>
+#include <cstdint>
+#include <algorithm>
 #include <stdexcept>
-
-#include <ljh/get_index.hpp>
+#include <string_view>
 
 namespace Base64
 {
@@ -19,63 +19,55 @@ namespace Base64
         'w','x','y','z','0','1','2','3','4','5','6','7','8','9','+','/',
     };
 
-    inline std::string encode(std::string message)
+    inline std::string encode(std::string_view message)
     {
         std::string output;
-        for (int a = 0; a < message.size(); a += 3)
+        output.reserve((message.size() + 2) / 3 * 4);
+        for (std::size_t a = 0; a < message.size(); a += 3)
         {
-            std::bitset<24> value = 0;
-            int s;
-            for (s = 0; s < 3; s++)
-            {
-                value <<= 8;
-                if (s + a < message.size())
-                {
-                    value |= uint32_t(message[s + a]);
-                }
-                else
-                {
-                    value <<= 8 * (2 - s);
-                    break;
-                }
-            }
-            for (int b = 0; b < 4; b++)
-            {
-                if (b < (s == 1 ? 2 : s == 2 ? 3 : 4))
-                    output += table[((value >> (6 * (3 - b))) & std::bitset<24>(0b111111)).to_ulong()];
-                else
-                    output += '=';
-            }
+            auto left = std::min<std::size_t>(message.size() - a, 3);
+            uint32_t value = 0;
+            for (std::size_t s = 0; s < 3; s++)
+                value = (value << 8) | (s < left ? static_cast<unsigned char>(message[a + s]) : 0);
+
+            for (std::size_t b = 0; b < 4; b++)
+                output += b <= left ? table[(value >> (6 * (3 - b))) & 0x3F] : '=';
         }
         return output;
     }
 
-    inline std::string decode(std::string message)
+    inline std::string decode(std::string_view message)
     {
+        static constexpr auto values = [] {
+            std::array<int8_t, 256> values{};
+            for (auto& value : values)
+                value = -1;
+            for (std::size_t a = 0; a < table.size(); a++)
+                values[static_cast<unsigned char>(table[a])] = static_cast<int8_t>(a);
+            return values;
+        }();
+
+        while (!message.empty() && message.back() == '=')
+            message.remove_suffix(1);
+
         std::string output;
-        std::bitset<24> value = 0;
-        int shifts = 0;
-        for (auto& letter : message)
+        output.reserve(message.size() * 3 / 4);
+        uint32_t value = 0;
+        int bits = 0;
+        for (auto letter : message)
         {
-            auto index = ljh::get_index(table.begin(), table.end(), letter);
-            
-            if (!(index > 0 && index < std::size(table)) && letter != '=')
+            auto index = values[static_cast<unsigned char>(letter)];
+            if (index < 0)
                 throw std::out_of_range("(Base64::decode) Unknown character");
-            else if (letter == '=')
-                index = 0;
-
-            value <<= 6;
-            value |= index;
-            shifts++;
 
-            if (shifts == 4)
+            value = (value << 6) | index;
+            bits += 6;
+            if (bits >= 8)
             {
-                for (int a = 0; a < 3; a++)
-                    output += (char)(((value >> (8 * (2 - a))) & std::bitset<24>(0xFF)).to_ulong());
-                value = 0;
-                shifts = 0;
+                bits -= 8;
+                output += static_cast<char>((value >> bits) & 0xFF);
             }
         }
-        return output.substr(0, output.find_last_not_of('\0') + 1);
+        return output;
     }
 }
\ No newline at end of file
@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <string>
+#include <algorithm>
+#include <string_view>
+#include <stdexcept>
+
+#include <zlib.h>
+
+// HTTP content codings on top of zlib. "deflate" is the zlib wrapped stream
+// (RFC 1950), as HTTP specifies, not a raw deflate stream.
+namespace Compression
+{
+    enum class Encoding
+    {
+        Identity, Gzip, Deflate,
+    };
+
+    inline std::string_view name(Encoding encoding)
+    {
+        switch (encoding)
+        {
+        case Encoding::Gzip   : return "gzip"    ;
+        case Encoding::Deflate: return "deflate" ;
+        default               : return "identity";
+        }
+    }
+
+    inline Encoding from_name(std::string_view name)
+    {
+        if (name == "gzip" || name == "x-gzip") return Encoding::Gzip   ;
+        if (name == "deflate"                 ) return Encoding::Deflate;
+        return Encoding::Identity;
+    }
+
+    // Picks the coding to use from an Accept-Encoding header. gzip wins over
+    // deflate, and anything offered with q=0 is treated as refused.
+    inline Encoding negotiate(std::string_view accept_encoding)
+    {
+        auto trim = [](std::string_view text) {
+            while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+            while (!text.empty() && (text.back () == ' ' || text.back () == '\t')) text.remove_suffix(1);
+            return text;
+        };
+
+        bool gzip = false, deflate = false;
+        while (!accept_encoding.empty())
+        {
+            auto end = accept_encoding.find(',');
+            auto coding = accept_encoding.substr(0, end);
+            accept_encoding = end == std::string_view::npos ? std::string_view{} : accept_encoding.substr(end + 1);
+
+            auto parameters = coding.find(';');
+            auto token = trim(coding.substr(0, parameters));
+            if (parameters != std::string_view::npos)
+            {
+                auto q = trim(coding.substr(parameters + 1));
+                if (q.substr(0, 2) == "q=" && q.find_first_not_of("0.", 2) == std::string_view::npos)
+                    continue;
+            }
+
+            auto encoding = from_name(token);
+            gzip    |= encoding == Encoding::Gzip    || token == "*";
+            deflate |= encoding == Encoding::Deflate;
+        }
+
+        if (gzip   ) return Encoding::Gzip   ;
+        if (deflate) return Encoding::Deflate;
+        return Encoding::Identity;
+    }
+
+    inline std::string compress(std::string_view input, Encoding encoding, int level = Z_DEFAULT_COMPRESSION)
+    {
+        if (encoding == Encoding::Identity)
+            return std::string{input};
+
+        z_stream stream{};
+        int window = encoding == Encoding::Gzip ? 15 + 16 : 15;
+        if (deflateInit2(&stream, level, Z_DEFLATED, window, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            throw std::runtime_error("deflateInit2 failed");
+
+        std::string output;
+        output.resize(deflateBound(&stream, static_cast<uLong>(input.size())));
+
+        stream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        stream.avail_in  = static_cast<uInt>(input.size());
+        stream.next_out  = reinterpret_cast<Bytef*>(output.data());
+        stream.avail_out = static_cast<uInt>(output.size());
+
+        auto result = deflate(&stream, Z_FINISH);
+        output.resize(stream.total_out);
+        deflateEnd(&stream);
+
+        if (result != Z_STREAM_END)
+            throw std::runtime_error("deflate failed");
+        return output;
+    }
+
+    // Takes either gzip or zlib framing, whichever the data starts with.
+    inline std::string decompress(std::string_view input)
+    {
+        z_stream stream{};
+        if (inflateInit2(&stream, 15 + 32) != Z_OK)
+            throw std::runtime_error("inflateInit2 failed");
+
+        stream.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        stream.avail_in = static_cast<uInt>(input.size());
+
+        std::string output;
+        int result = Z_OK;
+        while (result == Z_OK)
+        {
+            auto done = output.size();
+            output.resize(done + std::max<std::size_t>(input.size() * 4, 16 * 1024));
+            stream.next_out  = reinterpret_cast<Bytef*>(output.data() + done);
+            stream.avail_out = static_cast<uInt>(output.size() - done);
+            result = inflate(&stream, Z_NO_FLUSH);
+            output.resize(output.size() - stream.avail_out);
+
+            // Concatenated gzip members, like gunzip does.
+            if (result == Z_STREAM_END && stream.avail_in != 0)
+                result = inflateReset(&stream);
+        }
+        inflateEnd(&stream);
+
+        if (result != Z_STREAM_END)
+            throw std::runtime_error("inflate failed");
+        return output;
+    }
+}
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-3.0-or-later OR BSL-1.0
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+/*
+    This file is licensed under GPL v3 or later, and Boost Software Licence.
+    This is so that you may use this file in your own projects without needing
+    to follow the GPL license.
+*/
+
+#pragma once
+
+#include "reflection.hpp"
+
+#include "server.hpp"
+#include "drives.hpp"
+#include "updates.hpp"
+#include "network.hpp"
+#include "services.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+namespace Bakaneko
+{
+    // Reply to /batch?sections=system,drives,... Only the members named in
+    // sections with a status of OK hold data, the rest are left empty.
+    struct Batch
+    {
+        struct Section
+        {
+            enum Status
+            {
+                OK = 0,
+                NotImplemented = 1,
+                Failed = 2,
+            };
+
+            std::string name;
+            Status status;
+        };
+
+        std::vector<Section> sections;
+
+        System      system;
+        ServiceInfo service;
+        Services    services;
+        Drives      drives;
+        Updates     updates;
+        Adapters    adapters;
+    };
+
+    BAKANEKO_DEFINE_TYPE(Batch::Section, name, status)
+    BAKANEKO_DEFINE_TYPE(Batch, sections, system, service, services, drives, updates, adapters)
+}
@@ -9,7 +9,7 @@
 
 #pragma once
 
-#include <nlohmann/json.hpp>
+#include "reflection.hpp"
 
 #include <cstdint>
 #include <vector>
@@ -24,6 +24,9 @@ namespace Bakaneko
         uint64_t used;
         std::string mountpoint;
         std::string filesystem;
+        // False when the filesystem didn't answer in time (a hung network
+        // mount, say), size is then the partition's and used is 0.
+        bool available = true;
     };
 
     struct Drive
@@ -41,7 +44,7 @@ namespace Bakaneko
         std::vector<Drive> drives;
     };
 
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Partition, dev_node, size, used, mountpoint, filesystem)
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Drive, dev_node, size, model, manufacturer, interface, partitions)
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Drives, drives)
+    BAKANEKO_DEFINE_TYPE_WITH_DEFAULT(Partition, dev_node, size, used, mountpoint, filesystem, available)
+    BAKANEKO_DEFINE_TYPE(Drive, dev_node, size, model, manufacturer, interface, partitions)
+    BAKANEKO_DEFINE_TYPE(Drives, drives)
 }
\ No newline at end of file
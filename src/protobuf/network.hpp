@@ -9,7 +9,7 @@
 
 #pragma once
 
-#include <nlohmann/json.hpp>
+#include "reflection.hpp"
 
 #include <cstdint>
 #include <vector>
@@ -35,6 +35,15 @@ namespace Bakaneko
         uint64_t bytes_rx; // Total Bytes received
         uint64_t bytes_tx; // Total Bytes sent
         uint64_t time;     // Time the data bytes_rx and bytes_tx were gotten
+        // Bytes per second, worked out by the server from its last two
+        // samples. Only meaningful when interval isn't 0, older servers and
+        // ones with sampling turned off leave it to the client.
+        uint64_t rx_rate = 0;
+        uint64_t tx_rate = 0;
+        uint64_t interval = 0; // Nanoseconds between those two samples
+        // Every IPv4 then IPv6 address, ip_address is the first IPv4 one
+        // while the adapter is up.
+        std::vector<std::string> addresses;
     };
 
     struct Adapters
@@ -42,6 +51,30 @@ namespace Bakaneko
         std::vector<Adapter> adapters;
     };
 
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Adapter, name, state, link_speed, mtu, mac_address, ip_address, bytes_rx, bytes_tx, time)
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Adapters, adapters)
+    struct AdapterSample
+    {
+        uint64_t time;
+        uint64_t bytes_rx;
+        uint64_t bytes_tx;
+        uint64_t rx_rate;
+        uint64_t tx_rate;
+    };
+
+    struct AdapterHistory
+    {
+        std::string name;
+        std::vector<AdapterSample> samples; // Oldest first
+    };
+
+    struct AdaptersHistory
+    {
+        uint64_t interval; // Nanoseconds between samples the server aims for
+        std::vector<AdapterHistory> adapters;
+    };
+
+    BAKANEKO_DEFINE_TYPE_WITH_DEFAULT(Adapter, name, state, link_speed, mtu, mac_address, ip_address, bytes_rx, bytes_tx, time, rx_rate, tx_rate, interval, addresses)
+    BAKANEKO_DEFINE_TYPE(Adapters, adapters)
+    BAKANEKO_DEFINE_TYPE(AdapterSample, time, bytes_rx, bytes_tx, rx_rate, tx_rate)
+    BAKANEKO_DEFINE_TYPE(AdapterHistory, name, samples)
+    BAKANEKO_DEFINE_TYPE(AdaptersHistory, interval, adapters)
 }
\ No newline at end of file
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-3.0-or-later OR BSL-1.0
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+/*
+    This file is licensed under GPL v3 or later, and Boost Software Licence.
+    This is so that you may use this file in your own projects without needing
+    to follow the GPL license.
+*/
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <type_traits>
+#include <utility>
+
+// Same as NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE, but also defines
+// visit_fields(value, visitor), which calls visitor(name, member) for each
+// listed member in order. Serializers that don't want to go through a
+// nlohmann::json DOM find it by ADL.
+#define BAKANEKO_VISIT_FIELD(v1) bakaneko_visitor(#v1, bakaneko_value.v1);
+
+#define BAKANEKO_DEFINE_TYPE(Type, ...) \
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Type, __VA_ARGS__) \
+    template<typename Visitor> \
+    inline void visit_fields(const Type& bakaneko_value, Visitor&& bakaneko_visitor) { NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(BAKANEKO_VISIT_FIELD, __VA_ARGS__)) } \
+    constexpr std::size_t field_count(const Type*) { return NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(BAKANEKO_COUNT_FIELD, __VA_ARGS__)) 0; }
+
+#define BAKANEKO_COUNT_FIELD(v1) 1 +
+
+// Same as BAKANEKO_DEFINE_TYPE, but keys missing from the JSON leave the
+// member at its default instead of throwing. For types that gained fields,
+// so each side still reads what the other side's older version sends.
+#define BAKANEKO_FROM_JSON_WITH_DEFAULT(v1) if (auto bakaneko_field = nlohmann_json_j.find(#v1); bakaneko_field != nlohmann_json_j.end()) bakaneko_field->get_to(nlohmann_json_t.v1);
+
+#define BAKANEKO_DEFINE_TYPE_WITH_DEFAULT(Type, ...) \
+    inline void to_json(nlohmann::json& nlohmann_json_j, const Type& nlohmann_json_t) { NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(NLOHMANN_JSON_TO, __VA_ARGS__)) } \
+    inline void from_json(const nlohmann::json& nlohmann_json_j, Type& nlohmann_json_t) { NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(BAKANEKO_FROM_JSON_WITH_DEFAULT, __VA_ARGS__)) } \
+    template<typename Visitor> \
+    inline void visit_fields(const Type& bakaneko_value, Visitor&& bakaneko_visitor) { NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(BAKANEKO_VISIT_FIELD, __VA_ARGS__)) } \
+    constexpr std::size_t field_count(const Type*) { return NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(BAKANEKO_COUNT_FIELD, __VA_ARGS__)) 0; }
+
+namespace Bakaneko
+{
+    template<typename T, typename = void>
+    struct is_reflected : std::false_type {};
+
+    template<typename T>
+    struct is_reflected<T, std::void_t<decltype(field_count(static_cast<const T*>(nullptr)))>> : std::true_type {};
+
+    template<typename T>
+    inline constexpr bool is_reflected_v = is_reflected<T>::value;
+}
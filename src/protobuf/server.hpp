@@ -9,7 +9,7 @@
 
 #pragma once
 
-#include <nlohmann/json.hpp>
+#include "reflection.hpp"
 
 #include <cstdint>
 #include <vector>
@@ -29,5 +29,15 @@ namespace Bakaneko
         std::string icon;
     };
 
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(System, hostname, mac_address, ip_address, operating_system, kernel, architecture, vm_platform, icon)
+    BAKANEKO_DEFINE_TYPE(System, hostname, mac_address, ip_address, operating_system, kernel, architecture, vm_platform, icon)
+
+    struct Session
+    {
+        // Sent back as "Authorization: Bearer <token>".
+        std::string token;
+        // Seconds it's accepted for.
+        int64_t expires_in = 0;
+    };
+
+    BAKANEKO_DEFINE_TYPE(Session, token, expires_in)
 }
\ No newline at end of file
@@ -9,7 +9,7 @@
 
 #pragma once
 
-#include <nlohmann/json.hpp>
+#include "reflection.hpp"
 
 #include <cstdint>
 #include <vector>
@@ -68,11 +68,14 @@ namespace Bakaneko
     struct Services
     {
         std::vector<Service> services;
+        // Goes up whenever the list changes, when the server keeps track.
+        // 0 when it lists them afresh every time.
+        uint64_t revision = 0;
     };
 
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Service, id, state, enabled, type, display_name, description)
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(ServiceInfo, server, types)
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Services, services)
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(ServicesRequest, type)
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Service::Control, id, action)
+    BAKANEKO_DEFINE_TYPE(Service, id, state, enabled, type, display_name, description)
+    BAKANEKO_DEFINE_TYPE(ServiceInfo, server, types)
+    BAKANEKO_DEFINE_TYPE_WITH_DEFAULT(Services, services, revision)
+    BAKANEKO_DEFINE_TYPE(ServicesRequest, type)
+    BAKANEKO_DEFINE_TYPE(Service::Control, id, action)
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-3.0-or-later OR BSL-1.0
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+/*
+    This file is licensed under GPL v3 or later, and Boost Software Licence.
+    This is so that you may use this file in your own projects without needing
+    to follow the GPL license.
+*/
+
+#pragma once
+
+#include "reflection.hpp"
+
+#include "drives.hpp"
+#include "network.hpp"
+#include "services.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+namespace Bakaneko
+{
+    // Sent by the client on /stream, as a text message, to choose which
+    // sections it gets pushed. Sending it again replaces the last one.
+    struct StreamRequest
+    {
+        std::vector<std::string> subscribe;
+    };
+
+    // Pushed by the server. The first message for a section has full set and
+    // holds every record, after that only records that were added or changed
+    // are sent, plus the ids of removed ones. Records are keyed by name
+    // (adapters), id (services) or dev_node (drives).
+    struct AdapterChanges
+    {
+        std::string section;
+        uint64_t revision;
+        bool full;
+        std::vector<Adapter> changed;
+        std::vector<std::string> removed;
+    };
+
+    struct ServiceChanges
+    {
+        std::string section;
+        uint64_t revision;
+        bool full;
+        std::vector<Service> changed;
+        std::vector<std::string> removed;
+    };
+
+    struct DriveChanges
+    {
+        std::string section;
+        uint64_t revision;
+        bool full;
+        std::vector<Drive> changed;
+        std::vector<std::string> removed;
+    };
+
+    BAKANEKO_DEFINE_TYPE(StreamRequest, subscribe)
+    BAKANEKO_DEFINE_TYPE(AdapterChanges, section, revision, full, changed, removed)
+    BAKANEKO_DEFINE_TYPE(ServiceChanges, section, revision, full, changed, removed)
+    BAKANEKO_DEFINE_TYPE(DriveChanges, section, revision, full, changed, removed)
+}
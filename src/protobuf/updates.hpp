@@ -9,7 +9,7 @@
 
 #pragma once
 
-#include <nlohmann/json.hpp>
+#include "reflection.hpp"
 
 #include <cstdint>
 #include <vector>
@@ -30,6 +30,6 @@ namespace Bakaneko
         std::vector<Update> updates;
     };
 
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Update, source, name, old_version, new_version)
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Updates, updates)
+    BAKANEKO_DEFINE_TYPE(Update, source, name, old_version, new_version)
+    BAKANEKO_DEFINE_TYPE(Updates, updates)
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "access_log.hpp"
+#include "config.hpp"
+
+#include <memory>
+#include <cstdint>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/async.h>
+#include <spdlog/sinks/stdout_sinks.h>
+#include <spdlog/sinks/basic_file_sink.h>
+
+namespace
+{
+    // Set once by start() before any requests come in, and only cleared by
+    // stop() once they've all stopped.
+    std::shared_ptr<spdlog::logger> logger;
+}
+
+void AccessLog::start()
+{
+    if (!config.log.access)
+        return;
+
+    spdlog::sink_ptr sink;
+    try
+    {
+        if (config.log.access_file.empty())
+            sink = std::make_shared<spdlog::sinks::stdout_sink_mt>();
+        else
+            sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(config.log.access_file);
+    }
+    catch (const spdlog::spdlog_ex& e)
+    {
+        spdlog::error("Not writing an access log, couldn't open '{}': {}", config.log.access_file, e.what());
+        return;
+    }
+
+    spdlog::init_thread_pool(config.log.access_queue, 1);
+    logger = std::make_shared<spdlog::async_logger>("access", std::move(sink), spdlog::thread_pool(), spdlog::async_overflow_policy::overrun_oldest);
+    logger->set_pattern("%Y-%m-%dT%H:%M:%S.%e%z %v");
+    logger->set_level(spdlog::level::info);
+}
+
+void AccessLog::stop()
+{
+    if (!logger)
+        return;
+    // The thread pool writes out whatever is still queued before it goes.
+    logger->flush();
+    logger.reset();
+}
+
+void AccessLog::record(const Entry& entry)
+{
+    if (!logger)
+        return;
+
+    // Counted per thread so sampling doesn't need anything shared.
+    if (entry.status < 400 && config.log.access_sample > 1)
+    {
+        thread_local std::size_t seen = 0;
+        if (seen++ % config.log.access_sample != 0)
+            return;
+    }
+
+    auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(entry.duration).count();
+    logger->info("method={} route={} status={} bytes={} duration_ms={}.{:03} peer={}:{}",
+        entry.method, entry.route, entry.status, entry.bytes, microseconds / 1000, microseconds % 1000, entry.peer.address().to_string(), entry.peer.port());
+}
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string_view>
+
+#include <boost/asio/ip/tcp.hpp>
+
+namespace asio = boost::asio;
+
+// One line per answered request, as key=value pairs. Lines are formatted
+// where the request finished and queued to a background thread that does
+// the writing, so io threads never wait on the sink. When the queue is full
+// the oldest lines are dropped instead.
+namespace AccessLog
+{
+    struct Entry
+    {
+        std::string_view method;
+        std::string_view route;
+        unsigned status;
+        std::size_t bytes;
+        std::chrono::steady_clock::duration duration;
+        const asio::ip::tcp::endpoint& peer;
+    };
+
+    // Set up from config.log, call start() after the config is loaded and
+    // stop() once nothing is logging any more, which writes what is left.
+    void start();
+    void stop();
+
+    void record(const Entry& entry);
+}
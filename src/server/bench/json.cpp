@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+// Serializing a Bakaneko::Services with 2,000 units, the old way through a
+// nlohmann::json DOM and dump(), against Json::write straight into the
+// string that becomes the response body.
+
+#include "json_writer.hpp"
+#include "services.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <cstddef>
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    volatile std::size_t sink;
+
+    Bakaneko::Services make_services(std::size_t count)
+    {
+        Bakaneko::Services services;
+        services.revision = 42;
+        services.services.reserve(count);
+        for (std::size_t a = 0; a < count; a++)
+        {
+            Bakaneko::Service service;
+            service.id           = "unit-" + std::to_string(a) + ".service";
+            service.state        = static_cast<Bakaneko::Service::State>(a % 4);
+            service.enabled      = a % 3 == 0;
+            service.type         = "systemd";
+            service.display_name = "Unit number " + std::to_string(a);
+            service.description  = "A made up unit with a \"quoted\" description, number " + std::to_string(a);
+            services.services.push_back(std::move(service));
+        }
+        return services;
+    }
+
+    template<typename F>
+    double milliseconds_per_run(std::size_t runs, F&& serialize)
+    {
+        std::size_t bytes = 0;
+        auto started = clock::now();
+        for (std::size_t a = 0; a < runs; a++)
+            bytes += serialize().size();
+        auto elapsed = clock::now() - started;
+        sink = bytes;
+        return std::chrono::duration<double, std::milli>(elapsed).count() / runs;
+    }
+}
+
+int main()
+{
+    constexpr std::size_t runs = 200;
+    auto services = make_services(2000);
+
+    // Both have to say the same thing, or the numbers mean nothing.
+    if (json::parse(Json::dump(services)) != json(services))
+    {
+        std::fprintf(stderr, "Json::dump and json(...).dump() disagree\n");
+        return 1;
+    }
+
+    auto dom = milliseconds_per_run(runs, [&services] {
+        return json(services).dump();
+    });
+    auto direct = milliseconds_per_run(runs, [&services] {
+        std::string body;
+        Json::write(body, services);
+        return body;
+    });
+
+    std::printf("%-22s %10s\n", "2000 services", "ms/body");
+    std::printf("%-22s %10.3f\n", "json(...).dump()", dom);
+    std::printf("%-22s %10.3f\n", "Json::write", direct);
+    return 0;
+}
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+// Pending upgrades on this host, read from each detected package manager's
+// database against running the command Info::Updates used to run. Also times
+// the version comparisons the readers lean on. Needs a Linux host with at
+// least one of pacman, dpkg/apt or apk for the first part.
+
+#include "packages.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <cstddef>
+#include <string_view>
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    volatile std::size_t sink;
+
+    double milliseconds(clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    // How the old path ran it, output read through popen.
+    std::size_t run_command(std::string_view command)
+    {
+        auto pipe = popen((std::string{command} + " 2>/dev/null").c_str(), "r");
+        if (!pipe)
+            return 0;
+
+        std::array<char, 4096> buffer;
+        std::size_t lines = 0;
+        while (fgets(buffer.data(), buffer.size(), pipe) != nullptr)
+            lines++;
+        pclose(pipe);
+        return lines;
+    }
+
+    template<typename F>
+    double nanoseconds_per_compare(F&& compare, const std::array<std::string_view, 8>& versions)
+    {
+        constexpr std::size_t compares = 1'000'000;
+        int total = 0;
+        auto started = clock::now();
+        for (std::size_t a = 0; a < compares; a++)
+            total += compare(versions[a % versions.size()], versions[(a * 3 + 1) % versions.size()]);
+        auto elapsed = clock::now() - started;
+        sink = static_cast<std::size_t>(total);
+        return std::chrono::duration<double, std::nano>(elapsed).count() / compares;
+    }
+}
+
+int main()
+{
+    constexpr std::size_t reads = 20;
+
+    // Before the table, detecting logs what it found.
+    auto& managers = Packages::detected();
+
+    std::printf("%-8s %10s %12s %12s\n", "manager", "upgrades", "read ms", "command ms");
+    for (auto manager : managers)
+    {
+        std::size_t found = 0;
+        auto started = clock::now();
+        for (std::size_t a = 0; a < reads; a++)
+        {
+            if (auto native = manager->read(); native)
+                found = native->size();
+        }
+        auto read = milliseconds(clock::now() - started) / reads;
+
+        started = clock::now();
+        sink = run_command(manager->command);
+        auto command = milliseconds(clock::now() - started);
+
+        std::printf("%-8.*s %10zu %12.3f %12.3f\n", static_cast<int>(manager->name.size()), manager->name.data(), found, read, command);
+    }
+    if (managers.empty())
+        std::printf("No package manager databases found on this host\n");
+
+    std::printf("\n%-8s %14s\n", "order", "ns/compare");
+    std::printf("%-8s %14.1f\n", "deb", nanoseconds_per_compare(&Packages::compare_deb,
+        {"1.0", "1:2.3.4-1ubuntu2", "2.3.4~rc1-1", "2.3.4-1", "2.36-9+deb12u4", "10.0", "1.0a", "1.0+git20240101"}));
+    std::printf("%-8s %14.1f\n", "alpm", nanoseconds_per_compare(&Packages::compare_alpm,
+        {"1.0-1", "1:2.3.4-1", "2.3.4rc1-1", "2.3.4-2", "6.9.7.arch1-1", "10.0-1", "1.0a-1", "1.0.r12.gabcdef-1"}));
+    std::printf("%-8s %14.1f\n", "apk", nanoseconds_per_compare(&Packages::compare_apk,
+        {"1.0-r0", "2.3.4-r1", "2.3.4_rc1-r0", "2.3.4_p2-r0", "1.36.1-r15", "10.0-r0", "1.0a-r0", "2.3.4_git20240101-r0"}));
+    return 0;
+}
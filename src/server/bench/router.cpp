@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+// Dispatch cost of Rest::Router as the route table grows. Each lookup
+// splits a target with a query string and finds its route, like
+// Connection::handler does, so the time per request should stay about the
+// same whatever the table size.
+
+#include "router.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace
+{
+    using verb = boost::beast::http::verb;
+    using clock = std::chrono::steady_clock;
+
+    // Something for the compiler to not optimize away.
+    volatile std::size_t sink;
+
+    double nanoseconds_per_lookup(std::size_t route_count)
+    {
+        // Paths have to outlive the router.
+        std::vector<std::string> paths;
+        paths.reserve(route_count);
+        for (std::size_t a = 0; a < route_count; a++)
+            paths.push_back("/section" + std::to_string(a) + "/items");
+
+        Rest::Router<std::size_t> router{};
+        for (std::size_t a = 0; a < route_count; a++)
+            router.add(a % 2 == 0 ? verb::get : verb::post, paths[a], a);
+
+        std::vector<std::string> targets;
+        for (std::size_t a = 0; a < route_count; a++)
+            targets.push_back(paths[a] + "?type=all&seconds=" + std::to_string(a));
+        targets.push_back("/not/a/route?x=1");
+
+        constexpr std::size_t lookups = 2'000'000;
+        std::size_t found = 0;
+        auto started = clock::now();
+        for (std::size_t a = 0; a < lookups; a++)
+        {
+            auto& target = targets[a % targets.size()];
+            auto index = a % targets.size();
+            Rest::Query query;
+            auto path = Rest::split_target(target, query);
+            if (auto route = router.find(index % 2 == 0 ? verb::get : verb::post, path); route != nullptr)
+                found += route->handler;
+        }
+        auto elapsed = clock::now() - started;
+        sink = found;
+
+        return std::chrono::duration<double, std::nano>(elapsed).count() / lookups;
+    }
+}
+
+int main()
+{
+    std::printf("%8s %14s\n", "routes", "ns/dispatch");
+    for (std::size_t routes : {8, 16, 32, 64, 128, 256})
+        std::printf("%8zu %14.1f\n", routes, nanoseconds_per_lookup(routes));
+    return 0;
+}
@@ -0,0 +1,328 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include <ljh/system_info.hpp>
+
+#if defined(LJH_TARGET_Linux)
+#include "bus.hpp"
+
+#include <mutex>
+#include <chrono>
+#include <utility>
+
+#include <fcntl.h>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include <spdlog/spdlog.h>
+
+struct Bus::Dispatcher::Watch
+{
+    // nullptr once libdbus has removed it, waits still in flight check.
+    DBusWatch* watch;
+    // On a dup of the connection's socket, so closing it leaves libdbus'
+    // own alone.
+    asio::posix::stream_descriptor descriptor;
+    bool waiting[2] = {false, false};
+};
+
+struct Bus::Dispatcher::Timeout
+{
+    DBusTimeout* timeout;
+    asio::steady_timer timer;
+    // Bumped whenever the timer is restarted or stopped, so a wait that
+    // was already on its way out doesn't fire a stale timeout.
+    uint64_t generation = 0;
+};
+
+namespace
+{
+    using wait_type = asio::posix::descriptor_base::wait_type;
+
+    constexpr struct
+    {
+        unsigned int flag;
+        wait_type type;
+    } directions[] = {
+        {DBUS_WATCH_READABLE, wait_type::wait_read },
+        {DBUS_WATCH_WRITABLE, wait_type::wait_write},
+    };
+
+    template <typename T>
+    std::shared_ptr<T>& state(void* data)
+    {
+        return *static_cast<std::shared_ptr<T>*>(data);
+    }
+
+    template <typename T>
+    void free_state(void* data)
+    {
+        delete static_cast<std::shared_ptr<T>*>(data);
+    }
+}
+
+ljh::unix::dbus::connection Bus::system()
+{
+    static std::mutex lock;
+    static ljh::unix::dbus::connection bus;
+
+    std::lock_guard guard{lock};
+    // Nothing reads the socket between calls, a quick non-blocking look at
+    // it is what notices the bus hung up in the meantime.
+    if (bus)
+        dbus_connection_read_write(bus, 0);
+    if (bus && dbus_connection_get_is_connected(bus))
+        return bus;
+
+    // Not dbus_bus_get's shared connection, libdbus keeps handing that out
+    // after it has been disconnected, and exits the process when it finds
+    // out.
+    ljh::unix::dbus::error error;
+    auto connection = dbus_bus_get_private(DBUS_BUS_SYSTEM, (DBusError*)error);
+    if (error)
+        throw error;
+    dbus_connection_set_exit_on_disconnect(connection, FALSE);
+
+    if (bus)
+    {
+        spdlog::info("Reconnected to the system bus");
+        // Anyone still holding the old one only gets disconnected errors
+        // from it either way.
+        dbus_connection_close(bus);
+    }
+    bus = ljh::unix::dbus::connection{connection};
+    return bus;
+}
+
+Bus::Dispatcher::Dispatcher(strand_type strand, SignalHandler on_signal, DisconnectHandler on_disconnect)
+    : strand(std::move(strand)), on_signal(std::move(on_signal)), on_disconnect(std::move(on_disconnect))
+{}
+
+Bus::Dispatcher::~Dispatcher()
+{
+    close();
+}
+
+void Bus::Dispatcher::open(ljh::unix::dbus::bus type)
+{
+    ljh::unix::dbus::error error;
+    auto connection = dbus_bus_get_private(static_cast<DBusBusType>(type), (DBusError*)error);
+    if (error)
+        throw error;
+    bus = ljh::unix::dbus::connection{connection};
+
+    // Bus connections exit the whole process when they drop by default.
+    dbus_connection_set_exit_on_disconnect(connection, FALSE);
+    dbus_connection_add_filter(connection, &Dispatcher::filter, this, nullptr);
+    dbus_connection_set_dispatch_status_function(connection, &Dispatcher::dispatch_status, this, nullptr);
+    dbus_connection_set_watch_functions(connection, &Dispatcher::add_watch, &Dispatcher::remove_watch, &Dispatcher::toggle_watch, this, nullptr);
+    dbus_connection_set_timeout_functions(connection, &Dispatcher::add_timeout, &Dispatcher::remove_timeout, &Dispatcher::toggle_timeout, this, nullptr);
+
+    // Whatever came in while connecting.
+    dispatch();
+}
+
+void Bus::Dispatcher::close()
+{
+    if (!bus)
+        return;
+
+    // Clearing the functions has libdbus remove every watch and timeout,
+    // which cancels their waits.
+    DBusConnection* connection = bus;
+    dbus_connection_set_watch_functions(connection, nullptr, nullptr, nullptr, nullptr, nullptr);
+    dbus_connection_set_timeout_functions(connection, nullptr, nullptr, nullptr, nullptr, nullptr);
+    dbus_connection_set_dispatch_status_function(connection, nullptr, nullptr, nullptr);
+    dbus_connection_remove_filter(connection, &Dispatcher::filter, this);
+    dbus_connection_close(connection);
+    bus = ljh::unix::dbus::connection{};
+}
+
+bool Bus::Dispatcher::is_open() const
+{
+    return bus;
+}
+
+void Bus::Dispatcher::add_match(const std::string& rule)
+{
+    // Without an error to fill in libdbus sends the rule and moves on.
+    dbus_bus_add_match(bus, rule.c_str(), nullptr);
+}
+
+void Bus::Dispatcher::send(const char* destination, const char* path, const char* interface, const char* method)
+{
+    auto call = dbus_message_new_method_call(destination, path, interface, method);
+    if (call == nullptr)
+        return;
+    dbus_message_set_no_reply(call, TRUE);
+    dbus_connection_send(bus, call, nullptr);
+    dbus_message_unref(call);
+}
+
+Bus::Dispatcher::strand_type& Bus::Dispatcher::get_strand()
+{
+    return strand;
+}
+
+ljh::unix::dbus::connection& Bus::Dispatcher::connection()
+{
+    return bus;
+}
+
+dbus_bool_t Bus::Dispatcher::add_watch(DBusWatch* watch, void* data)
+{
+    auto self = static_cast<Dispatcher*>(data);
+    auto fd = fcntl(dbus_watch_get_unix_fd(watch), F_DUPFD_CLOEXEC, 0);
+    if (fd < 0)
+        return FALSE;
+
+    auto added = std::make_shared<Watch>(Watch{watch, asio::posix::stream_descriptor{self->strand, fd}});
+    dbus_watch_set_data(watch, new std::shared_ptr<Watch>(added), &free_state<Watch>);
+    if (dbus_watch_get_enabled(watch))
+        self->wait(added);
+    return TRUE;
+}
+
+void Bus::Dispatcher::remove_watch(DBusWatch* watch, void*)
+{
+    if (auto removed = dbus_watch_get_data(watch))
+    {
+        boost::system::error_code ec;
+        state<Watch>(removed)->watch = nullptr;
+        state<Watch>(removed)->descriptor.cancel(ec);
+    }
+}
+
+void Bus::Dispatcher::toggle_watch(DBusWatch* watch, void* data)
+{
+    auto self = static_cast<Dispatcher*>(data);
+    auto& toggled = state<Watch>(dbus_watch_get_data(watch));
+    if (dbus_watch_get_enabled(watch))
+    {
+        self->wait(toggled);
+    }
+    else
+    {
+        boost::system::error_code ec;
+        toggled->descriptor.cancel(ec);
+    }
+}
+
+void Bus::Dispatcher::wait(const std::shared_ptr<Watch>& watch)
+{
+    auto flags = dbus_watch_get_flags(watch->watch);
+    for (std::size_t i = 0; i < std::size(directions); i++)
+    {
+        if ((flags & directions[i].flag) == 0 || watch->waiting[i])
+            continue;
+
+        watch->waiting[i] = true;
+        watch->descriptor.async_wait(directions[i].type, asio::bind_executor(strand, [this, self = shared_from_this(), watch, i](boost::system::error_code ec) {
+            watch->waiting[i] = false;
+            if (watch->watch == nullptr)
+                return;
+
+            // A cancelled wait was disabled, or toggled off and back on
+            // again before it came back, in which case it's rearmed below.
+            if (!ec)
+                dbus_watch_handle(watch->watch, directions[i].flag);
+            else if (ec != asio::error::operation_aborted)
+                dbus_watch_handle(watch->watch, DBUS_WATCH_ERROR);
+
+            // Handling it may have removed it.
+            if (watch->watch != nullptr && dbus_watch_get_enabled(watch->watch))
+                wait(watch);
+            dispatch();
+        }));
+    }
+}
+
+dbus_bool_t Bus::Dispatcher::add_timeout(DBusTimeout* timeout, void* data)
+{
+    auto self = static_cast<Dispatcher*>(data);
+    auto added = std::make_shared<Timeout>(Timeout{timeout, asio::steady_timer{self->strand}});
+    dbus_timeout_set_data(timeout, new std::shared_ptr<Timeout>(added), &free_state<Timeout>);
+    self->start(added);
+    return TRUE;
+}
+
+void Bus::Dispatcher::remove_timeout(DBusTimeout* timeout, void*)
+{
+    if (auto removed = dbus_timeout_get_data(timeout))
+    {
+        state<Timeout>(removed)->timeout = nullptr;
+        state<Timeout>(removed)->generation++;
+        state<Timeout>(removed)->timer.cancel();
+    }
+}
+
+void Bus::Dispatcher::toggle_timeout(DBusTimeout* timeout, void* data)
+{
+    auto self = static_cast<Dispatcher*>(data);
+    auto& toggled = state<Timeout>(dbus_timeout_get_data(timeout));
+    toggled->generation++;
+    toggled->timer.cancel();
+    self->start(toggled);
+}
+
+void Bus::Dispatcher::start(const std::shared_ptr<Timeout>& timeout)
+{
+    if (!dbus_timeout_get_enabled(timeout->timeout))
+        return;
+
+    auto generation = ++timeout->generation;
+    timeout->timer.expires_after(std::chrono::milliseconds{dbus_timeout_get_interval(timeout->timeout)});
+    timeout->timer.async_wait(asio::bind_executor(strand, [this, self = shared_from_this(), timeout, generation](boost::system::error_code ec) {
+        if (ec || timeout->timeout == nullptr || timeout->generation != generation)
+            return;
+
+        // libdbus timeouts repeat until they're removed or disabled.
+        dbus_timeout_handle(timeout->timeout);
+        if (timeout->timeout != nullptr && timeout->generation == generation)
+            start(timeout);
+        dispatch();
+    }));
+}
+
+void Bus::Dispatcher::dispatch_status(DBusConnection*, DBusDispatchStatus status, void* data)
+{
+    // Called from inside libdbus, which mustn't be re-entered from here.
+    auto self = static_cast<Dispatcher*>(data);
+    if (status != DBUS_DISPATCH_DATA_REMAINS || self->dispatch_queued)
+        return;
+    self->dispatch_queued = true;
+    asio::post(self->strand, [self = self->shared_from_this()] {
+        self->dispatch_queued = false;
+        self->dispatch();
+    });
+}
+
+void Bus::Dispatcher::dispatch()
+{
+    while (bus && dbus_connection_dispatch(bus) == DBUS_DISPATCH_DATA_REMAINS)
+        ;
+}
+
+DBusHandlerResult Bus::Dispatcher::filter(DBusConnection*, DBusMessage* message, void* data)
+{
+    auto self = static_cast<Dispatcher*>(data);
+    if (dbus_message_is_signal(message, DBUS_INTERFACE_LOCAL, "Disconnected"))
+    {
+        // Closing has to wait until libdbus is done dispatching.
+        asio::post(self->strand, [self = self->shared_from_this()] {
+            spdlog::warn("Lost the D-Bus connection");
+            self->close();
+            if (self->on_disconnect)
+                self->on_disconnect();
+        });
+        return DBUS_HANDLER_RESULT_HANDLED;
+    }
+
+    if (dbus_message_get_type(message) == DBUS_MESSAGE_TYPE_SIGNAL && self->on_signal)
+        self->on_signal(message);
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+#endif
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <functional>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <ljh/unix/dbus.hpp>
+
+namespace asio = boost::asio;
+
+namespace Bus
+{
+    // The system bus connection blocking calls from the collector and
+    // control pools share, instead of connecting, authenticating and saying
+    // Hello for every request. libdbus connections are safe to use from any
+    // number of threads at once. Connects on first use, and again once the
+    // bus has gone away (restarted, say); throws ljh::unix::dbus::error
+    // when it can't.
+    ljh::unix::dbus::connection system();
+
+    // A private bus connection run by an io_context instead of blocking
+    // calls: libdbus' watches become waits on its socket and its timeouts
+    // steady_timers, and whatever arrives is dispatched straight away.
+    //
+    // All of it runs on one strand. libdbus only calls back from inside
+    // calls made on the connection, so as long as the connection is only
+    // used from the strand, so are the callbacks.
+    class Dispatcher : public std::enable_shared_from_this<Dispatcher>
+    {
+    public:
+        using strand_type = asio::strand<asio::io_context::executor_type>;
+        // Called on the strand for every signal that matches a rule given
+        // to add_match().
+        using SignalHandler = std::function<void(DBusMessage* signal)>;
+        // Called on the strand once the connection is lost. The dispatcher
+        // is closed by then, connect a new one to carry on.
+        using DisconnectHandler = std::function<void()>;
+
+    private:
+        struct Watch;
+        struct Timeout;
+
+        strand_type strand;
+        ljh::unix::dbus::connection bus;
+        SignalHandler on_signal;
+        DisconnectHandler on_disconnect;
+        bool dispatch_queued = false;
+
+        static dbus_bool_t add_watch(DBusWatch* watch, void* data);
+        static void remove_watch(DBusWatch* watch, void* data);
+        static void toggle_watch(DBusWatch* watch, void* data);
+        static dbus_bool_t add_timeout(DBusTimeout* timeout, void* data);
+        static void remove_timeout(DBusTimeout* timeout, void* data);
+        static void toggle_timeout(DBusTimeout* timeout, void* data);
+        static void dispatch_status(DBusConnection* connection, DBusDispatchStatus status, void* data);
+        static DBusHandlerResult filter(DBusConnection* connection, DBusMessage* message, void* data);
+
+        void wait(const std::shared_ptr<Watch>& watch);
+        void start(const std::shared_ptr<Timeout>& timeout);
+        void dispatch();
+
+    public:
+        // Runs on strand, which whoever owns the dispatcher can share to
+        // keep their own state on the same one.
+        Dispatcher(strand_type strand, SignalHandler on_signal, DisconnectHandler on_disconnect);
+        ~Dispatcher();
+
+        Dispatcher(const Dispatcher&) = delete;
+        Dispatcher& operator=(const Dispatcher&) = delete;
+
+        // Connects to the bus and hooks it up to the io_context. Call on the
+        // strand, or before the io_context runs. Throws
+        // ljh::unix::dbus::error when there is no bus to connect to.
+        void open(ljh::unix::dbus::bus type);
+        // Unhooks and closes the connection. Call on the strand, or once the
+        // io_context has stopped running.
+        void close();
+
+        bool is_open() const;
+
+        // Asks the bus to route matching signals here, see the D-Bus spec
+        // for the rule syntax. Doesn't wait for the bus to answer.
+        void add_match(const std::string& rule);
+
+        // Calls a method that takes no arguments without waiting for, or
+        // wanting, a reply.
+        void send(const char* destination, const char* path, const char* interface, const char* method);
+
+        strand_type& get_strand();
+        ljh::unix::dbus::connection& connection();
+    };
+}
@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <future>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <ljh/expected.hpp>
+#include <ljh/function_traits.hpp>
+
+#include "info.hpp"
+#include "config.hpp"
+#include "metrics.hpp"
+
+// Result cache for collectors. Requests with the same key that arrive while a
+// collection is running wait on that collection instead of starting their
+// own, and a successful result is reused until its TTL runs out. Expired
+// results are dropped whenever a new key goes in, and past max_entries the
+// one closest to expiring makes room.
+template<typename T>
+class Cache
+{
+    using clock  = std::chrono::steady_clock;
+    using result = ljh::expected<T, Errors>;
+
+    static constexpr std::size_t max_entries = 64;
+
+    struct entry
+    {
+        std::shared_future<result> value;
+        clock::time_point expires = clock::time_point::max();
+    };
+
+    std::mutex lock;
+    std::map<std::string, entry, std::less<>> entries;
+
+public:
+    template<typename F>
+    result get(const std::string& key, std::chrono::milliseconds ttl, F&& collect)
+    {
+        std::unique_lock guard{lock};
+        if (auto item = entries.find(key); item != entries.end())
+        {
+            if (clock::now() < item->second.expires)
+            {
+                auto value = item->second.value;
+                guard.unlock();
+                return value.get();
+            }
+            entries.erase(item);
+        }
+
+        sweep();
+
+        std::promise<result> promise;
+        entries[key].value = promise.get_future().share();
+        guard.unlock();
+
+        try
+        {
+            auto value = collect();
+            promise.set_value(value);
+
+            guard.lock();
+            if (auto item = entries.find(key); item != entries.end())
+            {
+                if (value.has_value() && ttl.count() > 0)
+                    item->second.expires = clock::now() + ttl;
+                else
+                    entries.erase(item);
+            }
+            return value;
+        }
+        catch (...)
+        {
+            promise.set_exception(std::current_exception());
+
+            guard.lock();
+            entries.erase(key);
+            throw;
+        }
+    }
+
+private:
+    // Called with lock held. Collections still running are never dropped,
+    // their waiters need them.
+    void sweep()
+    {
+        auto now = clock::now();
+        for (auto item = entries.begin(); item != entries.end();)
+            item = item->second.expires <= now ? entries.erase(item) : std::next(item);
+
+        if (entries.size() < max_entries)
+            return;
+        auto oldest = entries.end();
+        for (auto item = entries.begin(); item != entries.end(); item++)
+        {
+            if (item->second.expires != clock::time_point::max() && (oldest == entries.end() || item->second.expires < oldest->second.expires))
+                oldest = item;
+        }
+        if (oldest != entries.end())
+            entries.erase(oldest);
+    }
+};
+
+// Results are shared per collector, so /batch, /stream and the single routes
+// all hit the same entries.
+template <auto function>
+auto& result_cache()
+{
+    using MessageReply = typename ljh::function_traits<decltype(function)>::return_type::value_type;
+    static Cache<MessageReply> cache;
+    return cache;
+}
+
+// Runs a collector, going through its cache when a key is given. Only the
+// time spent in the collector itself is counted, not waiting on the cache.
+template <auto function, typename... Args>
+auto Collect(std::string_view route, const std::string& key, const Fields& fields, Args&... args)
+{
+    using MessageReply = typename ljh::function_traits<decltype(function)>::return_type::value_type;
+
+    // Controls are the only ones run without a key, which keeps them apart
+    // from the collector on the same route.
+    auto series = [&] {
+        if (key.empty())
+        {
+            static const auto control = Metrics::collector("POST", route);
+            return control;
+        }
+        static const auto collector = Metrics::collector("GET", route);
+        return collector;
+    }();
+
+    auto collect = [&fields, &args..., series] {
+        auto started = Metrics::clock::now();
+        auto result = function(fields, args...);
+        Metrics::collected(series, Metrics::clock::now() - started);
+        return result;
+    };
+
+    if constexpr (!std::is_void_v<MessageReply>)
+    {
+        if (!key.empty())
+            return result_cache<function>().get(key, config.cache.get(route), collect);
+    }
+    return collect();
+}
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "config.hpp"
+#include "ini.hpp"
+
+#include <algorithm>
+
+Config config;
+
+static const char* const cacheable_routes[] = {
+    "drives", "system", "updates", "network/adapters", "service", "services",
+};
+
+std::chrono::milliseconds Config::Cache::get(std::string_view route) const
+{
+    if (!route.empty() && route.front() == '/')
+        route.remove_prefix(1);
+    if (auto item = ttl.find(route); item != ttl.end())
+        return item->second;
+    return default_ttl;
+}
+
+void Config::load(ini& file)
+{
+    auto& cache_section = file["cache"];
+    cache.default_ttl = std::chrono::milliseconds{static_cast<int64_t>(cache_section["default"].get<double>(0) * 1000)};
+    for (auto route : cacheable_routes)
+    {
+        if (cache_section.has(route))
+            cache.ttl[route] = std::chrono::milliseconds{static_cast<int64_t>(cache_section[route].get<double>() * 1000)};
+    }
+
+    auto& networking_section = file["networking"];
+    if (networking_section.has("idle_timeout"))
+        networking.idle_timeout = std::chrono::milliseconds{static_cast<int64_t>(networking_section["idle_timeout"].get<double>() * 1000)};
+    networking.max_requests = networking_section["max_requests"].get<std::size_t>(networking.max_requests);
+    networking.pipeline     = networking_section["pipeline"    ].get<std::size_t>(networking.pipeline    );
+
+    auto& admin_section = file["admin"];
+    if (admin_section.has("session_lifetime"))
+        admin.session_lifetime = std::chrono::milliseconds{static_cast<int64_t>(admin_section["session_lifetime"].get<double>() * 1000)};
+
+    auto& compression_section = file["compression"];
+    compression.threshold = compression_section["threshold"].get<std::size_t>(compression.threshold);
+    compression.level     = compression_section["level"    ].get<int        >(compression.level    );
+
+    auto& stream_section = file["stream"];
+    auto interval = [&stream_section](const char* name, std::chrono::milliseconds& value) {
+        if (stream_section.has(name))
+            value = std::chrono::milliseconds{std::max<int64_t>(static_cast<int64_t>(stream_section[name].get<double>() * 1000), 100)};
+    };
+    interval("network/adapters", stream.adapters);
+    interval("services"        , stream.services);
+    interval("drives"          , stream.drives  );
+
+    auto& drives_section = file["drives"];
+    if (drives_section.has("probe_timeout"))
+        drives.probe_timeout = std::chrono::milliseconds{static_cast<int64_t>(drives_section["probe_timeout"].get<double>() * 1000)};
+    drives.probe_threads = drives_section["probe_threads"].get<std::size_t>(drives.probe_threads);
+
+    auto& adapters_section = file["adapters"];
+    if (adapters_section.has("interval"))
+    {
+        auto interval = static_cast<int64_t>(adapters_section["interval"].get<double>() * 1000);
+        adapters.interval = std::chrono::milliseconds{interval > 0 ? std::max<int64_t>(interval, 100) : 0};
+    }
+    adapters.history = adapters_section["history"].get<std::size_t>(adapters.history);
+
+    auto& processes_section = file["processes"];
+    if (processes_section.has("timeout"))
+        processes.timeout = std::chrono::milliseconds{static_cast<int64_t>(processes_section["timeout"].get<double>() * 1000)};
+    processes.max_running = std::max<std::size_t>(processes_section["max_running"].get<std::size_t>(processes.max_running), 1);
+
+    auto& log_section = file["log"];
+    log.level         = log_section["level"        ].get<std::string>(log.level      );
+    log.access        = log_section["access"       ].get<bool       >(log.access     );
+    log.access_file   = log_section["access_file"  ].get<std::string>(log.access_file);
+    log.access_sample = std::max<std::size_t>(log_section["access_sample"].get<std::size_t>(log.access_sample), 1);
+    log.access_queue  = std::max<std::size_t>(log_section["access_queue" ].get<std::size_t>(log.access_queue ), 1);
+
+    auto& executor_section = file["executor"];
+    executor.fast    = executor_section["fast"   ].get<std::size_t>(executor.fast   );
+    executor.slow    = executor_section["slow"   ].get<std::size_t>(executor.slow   );
+    executor.control = executor_section["control"].get<std::size_t>(executor.control);
+}
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <map>
+#include <chrono>
+#include <string>
+#include <string_view>
+
+#include "executor.hpp"
+
+class ini;
+
+// Settings read once from bakaneko-server.ini at startup. Anything that is
+// needed on the request path should live here instead of re-reading the file.
+struct Config
+{
+    struct Cache
+    {
+        // How long a collected result is reused for. Keys are the route
+        // without the leading slash (e.g. "drives", "network/adapters").
+        std::chrono::milliseconds default_ttl{0};
+        std::map<std::string, std::chrono::milliseconds, std::less<>> ttl;
+
+        std::chrono::milliseconds get(std::string_view route) const;
+    } cache;
+
+    struct Networking
+    {
+        // How long a keep-alive connection may sit with no requests in
+        // flight before it is closed.
+        std::chrono::milliseconds idle_timeout{30000};
+        // Requests answered on one connection before it is closed, 0 for no
+        // limit.
+        std::size_t max_requests = 1000;
+        // Pipelined requests read ahead of the response being written.
+        std::size_t pipeline = 16;
+    } networking;
+
+    struct Admin
+    {
+        // How long a token from /session is accepted for.
+        std::chrono::milliseconds session_lifetime{300000};
+    } admin;
+
+    struct Compression
+    {
+        // Bodies smaller than this many bytes are always sent as is.
+        std::size_t threshold = 1024;
+        // zlib level from 1 (fastest) to 9 (smallest), 0 turns it off.
+        int level = 6;
+    } compression;
+
+    struct Stream
+    {
+        // How often each /stream section is sampled while anyone is
+        // subscribed to it.
+        std::chrono::milliseconds adapters{1000};
+        std::chrono::milliseconds services{5000};
+        std::chrono::milliseconds drives{30000};
+    } stream;
+
+    struct Drives
+    {
+        // How long a mounted filesystem gets to report its usage before it
+        // is shown as unavailable.
+        std::chrono::milliseconds probe_timeout{2000};
+        // Filesystems probed at the same time.
+        std::size_t probe_threads = 4;
+    } drives;
+
+    struct Adapters
+    {
+        // How often adapter counters are sampled for rates and history, 0
+        // to read them on every request instead.
+        std::chrono::milliseconds interval{1000};
+        // Samples kept per adapter for /network/adapters/history.
+        std::size_t history = 300;
+    } adapters;
+
+    struct Processes
+    {
+        // How long a command may run before it and everything it started
+        // is killed.
+        std::chrono::milliseconds timeout{120000};
+        // Commands running at the same time, the rest wait their turn.
+        std::size_t max_running = 4;
+    } processes;
+
+    struct Log
+    {
+        // Lowest level written, a spdlog level name ("debug", "info", ...).
+        // Debug messages on the request path are only there in builds with
+        // BAKANEKO_DEBUG_LOGGING on.
+        std::string level = "info";
+        // One line per request, written from a background thread.
+        bool access = true;
+        // Where access lines go, empty for standard output.
+        std::string access_file;
+        // Only one in this many successful requests gets a line, errors
+        // always do.
+        std::size_t access_sample = 1;
+        // Lines waiting to be written, the oldest are dropped past this.
+        std::size_t access_queue = 8192;
+    } log;
+
+    // Threads in each collector pool.
+    Executor::Sizes executor;
+
+    void load(ini& file);
+};
+
+extern Config config;
@@ -0,0 +1,275 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "credentials.hpp"
+
+#include <ljh/system_info.hpp>
+
+#include "ini.hpp"
+#include "config.hpp"
+#include "executor.hpp"
+
+#include <array>
+#include <mutex>
+#include <memory>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <system_error>
+#include <unordered_map>
+
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+
+#include <boost/asio/post.hpp>
+
+#include <spdlog/spdlog.h>
+
+#if defined(LJH_TARGET_Linux)
+#include "inotify.hpp"
+
+#include <sys/inotify.h>
+#endif
+
+extern std::string config_file;
+
+namespace
+{
+    using Digest = std::array<unsigned char, 32>;
+
+    // PBKDF2-HMAC-SHA256, a few tens of milliseconds per check.
+    constexpr int iterations = 100000;
+    // Tokens held at once, the ones closest to expiring make room.
+    constexpr std::size_t max_sessions = 1024;
+
+    // Random once per run, and written before anything is hashed with it.
+    std::once_flag salted;
+    std::array<unsigned char, 16> salt;
+
+    std::mutex lock;
+    // nullopt when the file has no password, then nothing matches.
+    std::optional<Digest> password_hash;
+    bool loaded = false;
+#if !defined(LJH_TARGET_Linux)
+    std::filesystem::file_time_type written;
+#endif
+    // Keyed by the token's SHA-256, so finding one says nothing about the
+    // tokens that are held.
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> sessions;
+
+    Digest derive(std::string_view password)
+    {
+        std::call_once(salted, [] {
+            if (RAND_bytes(salt.data(), salt.size()) != 1)
+                throw std::runtime_error("(Credentials) Couldn't generate a salt");
+        });
+
+        Digest digest;
+        PKCS5_PBKDF2_HMAC(password.data(), password.size(), salt.data(), salt.size(), iterations, EVP_sha256(), digest.size(), digest.data());
+        return digest;
+    }
+
+    std::string session_key(std::string_view token)
+    {
+        Digest digest;
+        EVP_Digest(token.data(), token.size(), digest.data(), nullptr, EVP_sha256(), nullptr);
+        return std::string(reinterpret_cast<const char*>(digest.data()), digest.size());
+    }
+
+    void load()
+    {
+#if !defined(LJH_TARGET_Linux)
+        std::error_code ec;
+        auto time = std::filesystem::last_write_time(config_file, ec);
+#endif
+        std::optional<std::string> password;
+        try
+        {
+            ini file;
+            file.load_file(config_file);
+            if (file["admin"].has("password"))
+                password = file["admin"]["password"].get<std::string>();
+        }
+        catch (const std::exception&)
+        {
+            // Likely caught halfway through being written, the next event
+            // reads it again.
+            spdlog::warn("Couldn't read the admin password from '{}', keeping the last one", config_file);
+            return;
+        }
+
+        std::optional<Digest> hash;
+        if (password)
+        {
+            hash = derive(*password);
+            OPENSSL_cleanse(password->data(), password->size());
+        }
+        else
+            spdlog::warn("The config file has no admin password, nothing needing one is allowed until it does");
+
+        std::lock_guard guard{lock};
+        if (loaded && hash != password_hash)
+        {
+            // Whoever had the old password doesn't keep their sessions.
+            spdlog::info("The admin password changed");
+            sessions.clear();
+        }
+        password_hash = hash;
+        loaded = true;
+#if !defined(LJH_TARGET_Linux)
+        written = time;
+#endif
+    }
+
+    // Reads the file if start() didn't, and where it isn't watched, again
+    // once it was written.
+    void refresh()
+    {
+#if defined(LJH_TARGET_Linux)
+        {
+            std::lock_guard guard{lock};
+            if (loaded)
+                return;
+        }
+#else
+        std::error_code ec;
+        auto time = std::filesystem::last_write_time(config_file, ec);
+        {
+            std::lock_guard guard{lock};
+            if (loaded && time == written)
+                return;
+        }
+#endif
+        load();
+    }
+
+#if defined(LJH_TARGET_Linux)
+    // Watches the directory the config file is in, since editors usually
+    // replace the file instead of writing it in place.
+    class Watcher
+    {
+        Inotify::Watcher::strand_type strand;
+        std::shared_ptr<Inotify::Watcher> inotify;
+
+    public:
+        explicit Watcher(asio::io_context& io_context)
+            : strand(io_context.get_executor())
+        {}
+
+        void start()
+        {
+            inotify = std::make_shared<Inotify::Watcher>(strand);
+            try
+            {
+                inotify->open();
+            }
+            catch (const std::system_error& e)
+            {
+                spdlog::info("Not watching the config file, changing the password needs a restart: {}", e.what());
+                stop();
+                return;
+            }
+
+            auto path = std::filesystem::absolute(config_file);
+            auto watch = inotify->add(path.parent_path(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR, [name = path.filename().string()](const Inotify::Event& event) {
+                // Hashing takes a while, so not on the io_context.
+                if ((event.mask & IN_Q_OVERFLOW) || event.name == name)
+                    asio::post(Executor::get(Executor::Pool::Slow), load);
+            });
+            if (watch < 0)
+                spdlog::info("Not watching '{}', changing the password needs a restart", path.parent_path().string());
+        }
+
+        void stop()
+        {
+            if (inotify)
+                inotify->close();
+            inotify.reset();
+        }
+    };
+
+    std::unique_ptr<Watcher> watcher;
+#endif
+}
+
+void Credentials::start(asio::io_context& io_context)
+{
+    load();
+#if defined(LJH_TARGET_Linux)
+    watcher = std::make_unique<Watcher>(io_context);
+    watcher->start();
+#endif
+}
+
+void Credentials::stop()
+{
+#if defined(LJH_TARGET_Linux)
+    if (watcher)
+        watcher->stop();
+    watcher.reset();
+#endif
+    std::lock_guard guard{lock};
+    sessions.clear();
+}
+
+bool Credentials::verify(std::string_view password)
+{
+    refresh();
+
+    // Hashed even when there's no password, so the answer takes as long
+    // either way.
+    auto digest = derive(password);
+
+    std::optional<Digest> expected;
+    {
+        std::lock_guard guard{lock};
+        expected = password_hash;
+    }
+    return expected.has_value() && CRYPTO_memcmp(digest.data(), expected->data(), digest.size()) == 0;
+}
+
+Credentials::Session Credentials::issue()
+{
+    std::array<unsigned char, 32> random;
+    if (RAND_bytes(random.data(), random.size()) != 1)
+        throw std::runtime_error("(Credentials::issue) Couldn't generate a token");
+
+    Session session;
+    session.lifetime = std::chrono::duration_cast<std::chrono::seconds>(config.admin.session_lifetime);
+    constexpr char digits[] = "0123456789abcdef";
+    session.token.reserve(random.size() * 2);
+    for (auto byte : random)
+    {
+        session.token += digits[byte >> 4];
+        session.token += digits[byte & 0xF];
+    }
+    OPENSSL_cleanse(random.data(), random.size());
+
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard guard{lock};
+    for (auto it = sessions.begin(); it != sessions.end();)
+        it = it->second <= now ? sessions.erase(it) : std::next(it);
+    if (sessions.size() >= max_sessions)
+        sessions.erase(std::min_element(sessions.begin(), sessions.end(), [](auto& a, auto& b) { return a.second < b.second; }));
+    sessions.emplace(session_key(session.token), now + session.lifetime);
+    return session;
+}
+
+bool Credentials::check(std::string_view token)
+{
+    refresh();
+
+    auto key = session_key(token);
+    std::lock_guard guard{lock};
+    auto found = sessions.find(key);
+    if (found == sessions.end())
+        return false;
+    if (found->second <= std::chrono::steady_clock::now())
+    {
+        sessions.erase(found);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+#include <boost/asio/io_context.hpp>
+
+namespace asio = boost::asio;
+
+// The admin password from the config file. It's read once, and again
+// whenever the file changes, and only kept as a salted PBKDF2 hash that is
+// compared in constant time. Checking a password is slow on purpose, so a
+// client sending many requests checks it once for a session token and
+// sends that instead.
+namespace Credentials
+{
+    // Call start() once the executors are running, it reads the password,
+    // and stop() once the io_context has stopped. On Linux the file is
+    // watched with inotify, elsewhere its write time is looked at on every
+    // check.
+    void start(asio::io_context& io_context);
+    void stop();
+
+    // Whether password is the admin password.
+    bool verify(std::string_view password);
+
+    struct Session
+    {
+        std::string token;
+        std::chrono::seconds lifetime;
+    };
+
+    // A new token, which check() accepts for config.admin.session_lifetime
+    // or until the password changes.
+    Session issue();
+    bool check(std::string_view token);
+}
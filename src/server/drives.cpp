@@ -2,10 +2,17 @@
 // SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
 
 #include "info.hpp"
+#include "probe.hpp"
+#include "sysfs.hpp"
 #include <filesystem>
-#include <set>
+#include <fstream>
+#include <charconv>
+#include <cctype>
+#include <list>
+#include <map>
+#include <algorithm>
+#include <string_view>
 #include <ljh/system_info.hpp>
-#include <ljh/string_utils.hpp>
 
 #if defined(LJH_TARGET_Windows)
 #include <ljh/windows/wmi.hpp>
@@ -15,8 +22,104 @@
 
 #undef interface
 
-extern std::string read_file(std::filesystem::path file_path);
-extern std::tuple<int, std::string> exec(const std::string &cmd);
+#if defined(LJH_TARGET_Linux)
+namespace
+{
+    // Undoes the octal escapes (\040 for a space) used by mountinfo.
+    std::string unescape_mount(std::string_view text)
+    {
+        std::string out;
+        out.reserve(text.size());
+        auto digit = [&](std::size_t a) { return text[a] >= '0' && text[a] <= '7'; };
+        for (std::size_t a = 0; a < text.size(); a++)
+        {
+            if (text[a] == '\\' && a + 3 < text.size() && digit(a + 1) && digit(a + 2) && digit(a + 3))
+            {
+                out += static_cast<char>((text[a + 1] - '0') * 64 + (text[a + 2] - '0') * 8 + (text[a + 3] - '0'));
+                a += 3;
+                continue;
+            }
+            out += text[a];
+        }
+        return out;
+    }
+
+    struct Mount
+    {
+        std::string mountpoint;
+        std::string filesystem;
+    };
+
+    // Mounts by device number ("8:1") and by source ("/dev/sda1"), the first
+    // mount of a device wins. Filesystems like btrfs report an anonymous
+    // device number, so those are only found by source.
+    struct Mounts
+    {
+        std::list<Mount> mounts;
+        std::map<std::string, const Mount*> by_dev;
+        std::map<std::string, const Mount*> by_source;
+
+        const Mount* find(const std::string& dev, const std::string& source) const
+        {
+            if (auto mount = by_dev.find(dev); mount != by_dev.end())
+                return mount->second;
+            if (auto mount = by_source.find(source); mount != by_source.end())
+                return mount->second;
+            return nullptr;
+        }
+    };
+
+    Mounts read_mounts()
+    {
+        Mounts mounts;
+
+        auto contents = Sysfs::read("/proc/self/mountinfo");
+        std::string_view lines = contents;
+        while (!lines.empty())
+        {
+            auto line = lines.substr(0, lines.find('\n'));
+            lines.remove_prefix(std::min(line.size() + 1, lines.size()));
+
+            // id parent major:minor root mountpoint options [optional...] - fstype source super-options
+            std::vector<std::string_view> fields;
+            std::string_view rest = line;
+            while (!rest.empty())
+            {
+                auto end = rest.find(' ');
+                fields.push_back(rest.substr(0, end));
+                rest = end == std::string_view::npos ? std::string_view{} : rest.substr(end + 1);
+            }
+
+            auto separator = std::find(fields.begin(), fields.end(), "-");
+            if (fields.size() < 5 || std::distance(separator, fields.end()) < 3)
+                continue;
+
+            auto& mount = mounts.mounts.emplace_back();
+            mount.mountpoint = unescape_mount(fields[4]);
+            mount.filesystem = std::string{separator[1]};
+
+            mounts.by_dev.emplace(std::string{fields[2]}, &mount);
+            mounts.by_source.emplace(unescape_mount(separator[2]), &mount);
+        }
+
+        return mounts;
+    }
+
+    // The filesystem type udev probed, which is what lsblk shows for
+    // partitions that aren't mounted.
+    std::string udev_filesystem(const std::string& dev)
+    {
+        std::ifstream in("/run/udev/data/b" + dev);
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (constexpr std::string_view key = "E:ID_FS_TYPE="; line.compare(0, key.size(), key) == 0)
+                return line.substr(key.size());
+        }
+        return {};
+    }
+}
+#endif
 
 ljh::expected<Bakaneko::Drives, Errors> Info::Drives(const Fields &fields)
 {
@@ -107,112 +210,88 @@ ljh::expected<Bakaneko::Drives, Errors> Info::Drives(const Fields &fields)
                   return a.dev_node > b.dev_node;
               });
 #elif defined(LJH_TARGET_Linux)
-    auto [exit_code, std_out] = exec("lsblk -brn --output NAME,MOUNTPOINT,MODEL,SIZE,FSTYPE,FSSIZE,FSUSED");
-    if (exit_code != 0)
-        std::tie(exit_code, std_out) = exec("lsblk -brn --output NAME,MOUNTPOINT,MODEL,SIZE,FSTYPE");
+    auto mounts = read_mounts();
 
-    std::set<std::string> drives_seen;
-    std::map<std::string, Bakaneko::Drive *> drives_;
+    auto add_partition = [&mounts](Bakaneko::Drive& drive, const std::filesystem::path& path) {
+        auto& partition = drive.partitions.emplace_back();
+        auto dev = Sysfs::value(path / "dev");
 
-    auto drive_strings = ljh::split(std_out, '\n');
-    for (auto drive_line : drive_strings)
-    {
-        if (drive_line.empty())
-            continue;
+        partition.dev_node = path.filename().string();
+        partition.size     = Sysfs::number<uint64_t>(path / "size").value_or(0) * 512;
+        partition.used     = partition.size;
 
-        auto info = ljh::split(drive_line, ' ');
-
-        if (drives_seen.find(info[0]) != drives_seen.end())
-            continue;
+        if (auto mount = mounts.find(dev, "/dev/" + partition.dev_node); mount != nullptr)
+        {
+            partition.mountpoint = mount->mountpoint;
+            partition.filesystem = mount->filesystem;
+        }
 
-        auto number = info[0].find_first_of("1234567890");
-        bool contains_base_drive = drives_seen.find(info[0].substr(0, number)) != drives_seen.end();
+        if (auto filesystem = udev_filesystem(dev); !filesystem.empty())
+            partition.filesystem = std::move(filesystem);
+    };
 
-        if (!contains_base_drive)
-        {
-            Bakaneko::Drive &drive = drives.drives.emplace_back();
+    std::error_code ec;
+    for (auto& entry : std::filesystem::directory_iterator("/sys/block", ec))
+    {
+        auto path = entry.path();
+        auto name = path.filename().string();
 
-            for (int a = 0; a < info[2].size(); a++)
-            {
-                if (info[2][a] == '\\' && info[2][a + 1] == 'x')
-                {
-                    size_t idx = 0;
-                    auto number = info[2].substr(a + 2, 2);
-                    char charar = std::stoi(number, &idx, 16);
-                    info[2][a] = charar;
-
-                    auto top = info[2].substr(0, a + 1);
-                    auto bot = info[2].substr(a + 2 + idx);
-                    info[2] = top + bot;
-                }
-            }
+        // Same as lsblk, ram disks and devices without media are left out.
+        if (name.compare(0, 3, "ram") == 0)
+            continue;
+        auto size = Sysfs::number<uint64_t>(path / "size").value_or(0) * 512;
+        if (size == 0)
+            continue;
 
-            drive.dev_node = (info[0]);
-            drive.model = (info[2]);
-            drive.size = (std::stoull(info[3]));
+        auto& drive = drives.drives.emplace_back();
+        drive.dev_node = name;
+        drive.model    = Sysfs::value(path / "device" / "model");
+        drive.size     = size;
 
-            drives_.emplace(info[0], &drive);
+        for (auto& child : std::filesystem::directory_iterator(path, ec))
+        {
+            if (std::filesystem::exists(child.path() / "partition", ec))
+                add_partition(drive, child.path());
         }
 
-        if (number != std::string::npos)
+        // A filesystem on the whole device, like a loop device or a disk
+        // without a partition table.
+        if (drive.partitions.empty())
         {
-            auto &parition = drives_.at(contains_base_drive ? info[0].substr(0, number) : info[0])->partitions.emplace_back();
-
-            for (int a = 0; a < info[1].size(); a++)
-            {
-                if (info[1][a] == '\\' && info[1][a + 1] == 'x')
-                {
-                    size_t idx = 0;
-                    auto number = info[1].substr(a + 2, 2);
-                    char charar = std::stoi(number, &idx, 16);
-                    info[1][a] = charar;
-
-                    auto top = info[1].substr(0, a + 1);
-                    auto bot = info[1].substr(a + 2 + idx);
-                    info[1] = top + bot;
-                }
-            }
-
-            parition.dev_node = (info[0]);
-            parition.mountpoint = (info[1]);
-            parition.filesystem = (info[4]);
-
-            if (info.size() <= 5)
-            {
-                auto df = ljh::split(ljh::split(std::get<1>(exec("df -aB1 /dev/" + info[0])), '\n')[1], ' ');
-                for (auto s = df.begin(); s != df.end(); s++)
-                {
-                    if (s->empty())
-                    {
-                        s = --df.erase(s);
-                    }
-                }
-                if (df[0] == "/dev/" + info[0])
-                {
-                    info.push_back(df[1]);
-                    info.push_back(df[4]);
-                }
-                else
-                {
-                    info.push_back("");
-                    info.push_back("");
-                }
-            }
+            if (mounts.find(Sysfs::value(path / "dev"), "/dev/" + name) != nullptr)
+                add_partition(drive, path);
+        }
+    }
 
-            if (!info[5].empty())
-            {
-                parition.size = (std::stoull(info[5]));
-                parition.used = (std::stoull(info[6]));
-            }
-            else
-            {
-                auto size = std::stoull(info[3]);
-                parition.size = (size);
-                parition.used = (size);
-            }
+    // Usage of every mounted partition at once, none of them can hold up
+    // the rest.
+    std::vector<Bakaneko::Partition*> mounted;
+    std::vector<std::string> mountpoints;
+    for (auto& drive : drives.drives)
+    {
+        for (auto& partition : drive.partitions)
+        {
+            if (partition.mountpoint.empty())
+                continue;
+            mounted.push_back(&partition);
+            mountpoints.push_back(partition.mountpoint);
         }
+    }
 
-        drives_seen.emplace(info[0]);
+    auto usage = Probe::usage(mountpoints);
+    for (std::size_t a = 0; a < mounted.size(); a++)
+    {
+        auto& partition = *mounted[a];
+        if (usage[a].available)
+        {
+            partition.size = usage[a].size;
+            partition.used = usage[a].used;
+        }
+        else
+        {
+            partition.used      = 0;
+            partition.available = false;
+        }
     }
 
     std::sort(drives.drives.begin(), drives.drives.end(),
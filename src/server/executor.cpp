@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "executor.hpp"
+
+#include <array>
+#include <memory>
+#include <algorithm>
+
+static std::array<std::unique_ptr<asio::thread_pool>, static_cast<std::size_t>(Executor::Pool::Count)> pools;
+
+void Executor::start(const Sizes& sizes)
+{
+    pools[static_cast<std::size_t>(Pool::Fast   )] = std::make_unique<asio::thread_pool>(std::max<std::size_t>(sizes.fast   , 1));
+    pools[static_cast<std::size_t>(Pool::Slow   )] = std::make_unique<asio::thread_pool>(std::max<std::size_t>(sizes.slow   , 1));
+    pools[static_cast<std::size_t>(Pool::Control)] = std::make_unique<asio::thread_pool>(std::max<std::size_t>(sizes.control, 1));
+}
+
+void Executor::stop()
+{
+    for (auto& pool : pools)
+    {
+        if (pool)
+            pool->stop();
+    }
+    for (auto& pool : pools)
+    {
+        if (pool)
+            pool->join();
+        pool.reset();
+    }
+}
+
+asio::thread_pool& Executor::get(Pool pool)
+{
+    return *pools[static_cast<std::size_t>(pool)];
+}
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <boost/asio/thread_pool.hpp>
+
+namespace asio = boost::asio;
+
+// Thread pools that run collectors and controls, so the io_context threads
+// only ever do network I/O. Each endpoint picks the pool that matches how
+// long it can block for, so a few slow /updates calls can't starve /system.
+namespace Executor
+{
+    enum class Pool
+    {
+        Fast,    // Reads from procfs/sysfs and similar
+        Slow,    // Forks package managers, walks D-Bus, stats mounts
+        Control, // Power and service control
+        Count,
+    };
+
+    struct Sizes
+    {
+        std::size_t fast    = 2;
+        std::size_t slow    = 4;
+        std::size_t control = 1;
+    };
+
+    void start(const Sizes& sizes);
+    void stop();
+
+    asio::thread_pool& get(Pool pool);
+}
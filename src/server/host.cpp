@@ -0,0 +1,226 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "host.hpp"
+
+#include <ljh/system_info.hpp>
+
+#if defined(LJH_TARGET_Linux)
+#include "info.hpp"
+#include "inotify.hpp"
+#include "netlink.hpp"
+#include "executor.hpp"
+
+#include <set>
+#include <mutex>
+#include <array>
+#include <string>
+#include <cerrno>
+#include <system_error>
+
+#include <sys/socket.h>
+#include <sys/utsname.h>
+#include <sys/inotify.h>
+#include <linux/rtnetlink.h>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include <spdlog/spdlog.h>
+
+namespace
+{
+    // Written in place, replaced by a rename, or a symlink swapped.
+    constexpr uint32_t file_events = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ONLYDIR;
+
+    // Watched by their directory, so they're seen being created as well,
+    // and the ones whose names matter in each. /etc/os-release is usually a
+    // link to /usr/lib/os-release.
+    const struct
+    {
+        const char* directory;
+        std::set<std::string> names;
+    } watched[] = {
+        {"/etc",     {"os-release", "machine-info", "hostname"}},
+        {"/usr/lib", {"os-release"}},
+    };
+
+    std::mutex lock;
+    std::shared_ptr<const Bakaneko::System> kept;
+    // The kernel's host name when kept was read.
+    std::string kept_nodename;
+    uint64_t current = 0;
+    bool keeping = false;
+
+    void invalidate()
+    {
+        std::lock_guard guard{lock};
+        current++;
+        kept.reset();
+    }
+
+    // Owns the inotify instance and the rtnetlink socket, everything runs
+    // on one strand.
+    class Watcher : public std::enable_shared_from_this<Watcher>
+    {
+        Inotify::Watcher::strand_type strand;
+        std::shared_ptr<Inotify::Watcher> inotify;
+        asio::posix::stream_descriptor netlink;
+
+        void receive()
+        {
+            netlink.async_wait(asio::posix::descriptor_base::wait_read, asio::bind_executor(strand, [this, self = shared_from_this()](boost::system::error_code ec) {
+                if (ec || !netlink.is_open())
+                    return;
+
+                // What changed doesn't matter, only that something did.
+                alignas(nlmsghdr) std::array<char, 8 * 1024> buffer;
+                for (;;)
+                {
+                    auto received = recv(netlink.native_handle(), buffer.data(), buffer.size(), 0);
+                    if (received < 0 && errno == EINTR)
+                        continue;
+                    // ENOBUFS means notifications were dropped, which is
+                    // one more reason to read everything again.
+                    if (received < 0 && errno != ENOBUFS)
+                        break;
+                }
+                invalidate();
+                receive();
+            }));
+        }
+
+    public:
+        explicit Watcher(asio::io_context& io_context)
+            : strand(io_context.get_executor()), netlink(strand)
+        {}
+
+        void start()
+        {
+            inotify = std::make_shared<Inotify::Watcher>(strand);
+            try
+            {
+                inotify->open();
+                netlink.assign(Netlink::subscribe(RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR));
+            }
+            catch (const std::system_error& e)
+            {
+                spdlog::info("Not caching the host identity: {}", e.what());
+                stop();
+                return;
+            }
+
+            for (auto& [directory, names] : watched)
+            {
+                inotify->add(directory, file_events, [names = &names](const Inotify::Event& event) {
+                    if ((event.mask & IN_Q_OVERFLOW) || names->count(event.name) != 0)
+                        invalidate();
+                });
+            }
+            receive();
+
+            {
+                std::lock_guard guard{lock};
+                keeping = true;
+            }
+            asio::post(Executor::get(Executor::Pool::Slow), [] { Info::System(Fields{}); });
+        }
+
+        void stop()
+        {
+            {
+                std::lock_guard guard{lock};
+                keeping = false;
+                current++;
+                kept.reset();
+            }
+            if (inotify)
+                inotify->close();
+            inotify.reset();
+            boost::system::error_code ec;
+            netlink.close(ec);
+        }
+    };
+
+    std::shared_ptr<Watcher> watcher;
+}
+
+void Host::start(asio::io_context& io_context)
+{
+    watcher = std::make_shared<Watcher>(io_context);
+    watcher->start();
+}
+
+void Host::stop()
+{
+    if (watcher)
+        watcher->stop();
+    watcher.reset();
+}
+
+std::shared_ptr<const Bakaneko::System> Host::identity()
+{
+    // `hostname foo` and transient names from hostnamed only change the
+    // kernel's copy.
+    auto name = nodename();
+    std::lock_guard guard{lock};
+    if (kept && name != kept_nodename)
+    {
+        current++;
+        kept.reset();
+    }
+    return kept;
+}
+
+uint64_t Host::generation()
+{
+    std::lock_guard guard{lock};
+    return current;
+}
+
+std::string Host::nodename()
+{
+    struct utsname buffer;
+    if (uname(&buffer) != 0)
+        return {};
+    return buffer.nodename;
+}
+
+void Host::keep(uint64_t generation, std::string nodename, Bakaneko::System system)
+{
+    std::lock_guard guard{lock};
+    if (keeping && generation == current)
+    {
+        kept = std::make_shared<const Bakaneko::System>(std::move(system));
+        kept_nodename = std::move(nodename);
+    }
+}
+#else
+void Host::start(asio::io_context& io_context)
+{
+}
+
+void Host::stop()
+{
+}
+
+std::shared_ptr<const Bakaneko::System> Host::identity()
+{
+    return nullptr;
+}
+
+uint64_t Host::generation()
+{
+    return 0;
+}
+
+std::string Host::nodename()
+{
+    return {};
+}
+
+void Host::keep(uint64_t generation, std::string nodename, Bakaneko::System system)
+{
+}
+#endif
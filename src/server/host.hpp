@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include <boost/asio/io_context.hpp>
+
+#include "server.hpp"
+
+namespace asio = boost::asio;
+
+// What /system reports: host name, operating system, kernel, icon and
+// primary address. None of it changes without one of /etc/os-release,
+// /etc/machine-info or /etc/hostname being written or an address or link
+// changing, so once started the server keeps the last answer until inotify
+// or rtnetlink say one of those happened. The kernel's host name can be set
+// without touching any file, so it's looked at with uname() every time.
+// Linux only.
+namespace Host
+{
+    // Call start() once the executors are running, it reads the identity
+    // on the slow pool, and stop() once the io_context has stopped.
+    void start(asio::io_context& io_context);
+    void stop();
+
+    // The identity as last kept, nullptr while not watching or since the
+    // last change.
+    std::shared_ptr<const Bakaneko::System> identity();
+
+    // Read before reading the identity, and hand back to keep(), which
+    // drops what was read if it changed in the meantime.
+    uint64_t generation();
+    std::string nodename();
+    void keep(uint64_t generation, std::string nodename, Bakaneko::System system);
+}
@@ -2,26 +2,50 @@
 // SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
 
 #include "info.hpp"
-#include "ini.hpp"
 #include "base64.hpp"
+#include "credentials.hpp"
 
 #include <stdexcept>
+#include <ljh/string_utils.hpp>
 #include <spdlog/spdlog.h>
 #include <spdlog/fmt/fmt.h>
 
-extern std::string config_file;
+namespace
+{
+    bool check_password(const std::string& base)
+    {
+        auto info = ljh::split(Base64::decode(base), ':', 2);
+        if (info[0] != "admin")
+            throw std::invalid_argument(fmt::format("(Authenticate) Unknown authentication user '{}'", info[0]));
+        return info.size() == 2 && Credentials::verify(info[1]);
+    }
+}
 
 bool Helpers::Authenticate(std::string authentication)
 {
     auto type_base = ljh::split(authentication, " ", 2);
+    if (type_base.size() != 2)
+        return false;
+    if (type_base[0] == "Bearer")
+        return Credentials::check(type_base[1]);
     if (type_base[0] != "Basic")
         throw std::invalid_argument(fmt::format("(Authenticate) Unknown authentication type '{}'", type_base[0]));
+    return check_password(type_base[1]);
+}
 
-    auto info = ljh::split(Base64::decode(type_base[1]),':', 2);
-    if (info[0] != "admin")
-        throw std::invalid_argument(fmt::format("(Authenticate) Unknown authentication user '{}'", info[0]));
+ljh::expected<Bakaneko::Session, Errors> Control::Session(const Fields& fields)
+{
+    // Only for the password itself, a session can't be stretched forever
+    // with its own token.
+    if (!fields.authentication.has_value())
+        return ljh::unexpected{Errors::NeedsPassword};
+    auto type_base = ljh::split(fields.authentication.value(), " ", 2);
+    if (type_base.size() != 2 || type_base[0] != "Basic" || !check_password(type_base[1]))
+        return ljh::unexpected{Errors::NeedsPassword};
 
-    ini ini_file;
-    ini_file.load_file(config_file);
-    return info[1] == ini_file["admin"]["password"].get<std::string>();
+    auto issued = Credentials::issue();
+    Bakaneko::Session session;
+    session.token = std::move(issued.token);
+    session.expires_in = issued.lifetime.count();
+    return session;
 }
\ No newline at end of file
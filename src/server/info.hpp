@@ -5,6 +5,7 @@
 #include <ljh/expected.hpp>
 #include <optional>
 #include <string>
+#include <map>
 
 #include "server.hpp"
 #include "updates.hpp"
@@ -20,6 +21,7 @@ enum class Errors
 struct Fields
 {
     std::optional<std::string> authentication;
+    std::map<std::string, std::string, std::less<>> query;
 };
 
 namespace Helpers
@@ -29,16 +31,18 @@ namespace Helpers
 
 namespace Info
 {
-    ljh::expected<Bakaneko::Drives     , Errors> Drives  (const Fields& fields);
-    ljh::expected<Bakaneko::Updates    , Errors> Updates (const Fields& fields);
-    ljh::expected<Bakaneko::System     , Errors> System  (const Fields& fields);
-    ljh::expected<Bakaneko::Adapters   , Errors> Adapters(const Fields& fields);
-    ljh::expected<Bakaneko::ServiceInfo, Errors> Service (const Fields& fields);
-    ljh::expected<Bakaneko::Services   , Errors> Services(const Fields& fields, Bakaneko::ServicesRequest data);
+    ljh::expected<Bakaneko::Drives         , Errors> Drives         (const Fields& fields);
+    ljh::expected<Bakaneko::Updates        , Errors> Updates        (const Fields& fields);
+    ljh::expected<Bakaneko::System         , Errors> System         (const Fields& fields);
+    ljh::expected<Bakaneko::Adapters       , Errors> Adapters       (const Fields& fields);
+    ljh::expected<Bakaneko::AdaptersHistory, Errors> AdaptersHistory(const Fields& fields);
+    ljh::expected<Bakaneko::ServiceInfo    , Errors> Service        (const Fields& fields);
+    ljh::expected<Bakaneko::Services       , Errors> Services       (const Fields& fields, Bakaneko::ServicesRequest data);
 };
 
 namespace Control
 {
+    ljh::expected<Bakaneko::Session, Errors> Session(const Fields& fields);
     ljh::expected<void, Errors> Shutdown(const Fields& fields);
     ljh::expected<void, Errors> Reboot  (const Fields& fields);
     ljh::expected<void, Errors> Service (const Fields& fields, Bakaneko::Service::Control data);
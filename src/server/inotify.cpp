@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include <ljh/system_info.hpp>
+
+#if defined(LJH_TARGET_Linux)
+#include "inotify.hpp"
+
+#include <vector>
+#include <cerrno>
+#include <system_error>
+
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include <boost/asio/bind_executor.hpp>
+
+Inotify::Watcher::Watcher(strand_type strand)
+    : strand(strand), descriptor(strand)
+{}
+
+Inotify::Watcher::~Watcher()
+{
+    close();
+}
+
+void Inotify::Watcher::open()
+{
+    auto fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "inotify_init1");
+    descriptor.assign(fd);
+    read();
+}
+
+void Inotify::Watcher::close()
+{
+    boost::system::error_code ec;
+    descriptor.close(ec);
+    handlers.clear();
+}
+
+bool Inotify::Watcher::is_open() const
+{
+    return descriptor.is_open();
+}
+
+int Inotify::Watcher::add(const std::filesystem::path& path, uint32_t mask, Handler handler)
+{
+    if (!descriptor.is_open())
+        return -1;
+    auto watch = inotify_add_watch(descriptor.native_handle(), path.c_str(), mask);
+    if (watch >= 0)
+        handlers.insert_or_assign(watch, std::move(handler));
+    return watch;
+}
+
+void Inotify::Watcher::remove(int watch)
+{
+    // The kernel still sends IN_IGNORED for it, which finds no handler.
+    if (handlers.erase(watch) != 0 && descriptor.is_open())
+        inotify_rm_watch(descriptor.native_handle(), watch);
+}
+
+void Inotify::Watcher::read()
+{
+    descriptor.async_wait(asio::posix::descriptor_base::wait_read, asio::bind_executor(strand, [this, self = shared_from_this()](boost::system::error_code ec) {
+        if (ec || !descriptor.is_open())
+            return;
+
+        // Enough for a few dozen events with names, reads only ever return
+        // whole ones.
+        alignas(inotify_event) char buffer[16 * 1024];
+        while (descriptor.is_open())
+        {
+            auto length = ::read(descriptor.native_handle(), buffer, sizeof(buffer));
+            if (length < 0 && errno == EINTR)
+                continue;
+            if (length <= 0)
+                break;
+
+            for (auto at = buffer; at < buffer + length;)
+            {
+                auto event = reinterpret_cast<const inotify_event*>(at);
+                at += sizeof(inotify_event) + event->len;
+                deliver(Event{event->wd, event->mask, event->len ? event->name : ""});
+            }
+        }
+
+        if (descriptor.is_open())
+            read();
+    }));
+}
+
+void Inotify::Watcher::deliver(const Event& event)
+{
+    // Handlers are copied before being called, they may well add or remove
+    // watches, their own included.
+    if (event.mask & IN_Q_OVERFLOW)
+    {
+        std::vector<Handler> all;
+        for (auto& [watch, handler] : handlers)
+            all.push_back(handler);
+        for (auto& handler : all)
+            handler(event);
+        return;
+    }
+
+    auto found = handlers.find(event.watch);
+    if (found == handlers.end())
+        return;
+    auto handler = found->second;
+    // The watch is gone: removed, or the path was deleted or unmounted.
+    if (event.mask & IN_IGNORED)
+        handlers.erase(found);
+    handler(event);
+}
+#endif
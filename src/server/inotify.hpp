@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <functional>
+#include <filesystem>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+namespace asio = boost::asio;
+
+namespace Inotify
+{
+    struct Event
+    {
+        int watch;
+        // IN_* flags, see inotify(7).
+        uint32_t mask;
+        // The entry inside a watched directory the event is about, empty
+        // for events on the watched path itself.
+        std::string name;
+    };
+
+    // An inotify instance read by an io_context, so watching files costs no
+    // thread and no polling. Linux only.
+    //
+    // All of it runs on one strand: handlers are called on it, and the
+    // watcher must only be used from it, or before the io_context runs.
+    class Watcher : public std::enable_shared_from_this<Watcher>
+    {
+    public:
+        using strand_type = asio::strand<asio::io_context::executor_type>;
+        // Also called, for every watch, with IN_Q_OVERFLOW when the kernel
+        // dropped events, after which anything could have changed.
+        using Handler = std::function<void(const Event& event)>;
+
+    private:
+        strand_type strand;
+        asio::posix::stream_descriptor descriptor;
+        std::map<int, Handler> handlers;
+
+        void read();
+        void deliver(const Event& event);
+
+    public:
+        explicit Watcher(strand_type strand);
+        ~Watcher();
+
+        Watcher(const Watcher&) = delete;
+        Watcher& operator=(const Watcher&) = delete;
+
+        // Throws std::system_error when inotify isn't available.
+        void open();
+        void close();
+
+        bool is_open() const;
+
+        // Calls handler for the events in mask on path. Watching a path
+        // that is already watched replaces its mask and handler. Returns the
+        // watch, or -1 when path can't be watched, usually because it
+        // doesn't exist.
+        int add(const std::filesystem::path& path, uint32_t mask, Handler handler);
+        void remove(int watch);
+    };
+}
@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <charconv>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+
+#include "reflection.hpp"
+
+// Writes Bakaneko types as JSON straight into a string, usually the body of a
+// response, walking the fields with visit_fields() instead of building a
+// nlohmann::json first. Output parses to the same value as json(value).dump(),
+// but keys come in declaration order rather than sorted.
+namespace Json
+{
+    namespace detail
+    {
+        // Length of the UTF-8 sequence starting at text[0], or 0 if it isn't
+        // a valid one.
+        inline std::size_t utf8_length(std::string_view text)
+        {
+            auto byte = [&](std::size_t a) { return static_cast<unsigned char>(text[a]); };
+            auto continuation = [&](std::size_t a) { return a < text.size() && (byte(a) & 0xC0) == 0x80; };
+
+            auto lead = byte(0);
+            if (lead < 0x80)
+                return 1;
+            if (lead >= 0xC2 && lead <= 0xDF)
+                return continuation(1) ? 2 : 0;
+            if (lead >= 0xE0 && lead <= 0xEF)
+            {
+                if (!continuation(1) || !continuation(2)) return 0;
+                if (lead == 0xE0 && byte(1) < 0xA0) return 0; // overlong
+                if (lead == 0xED && byte(1) > 0x9F) return 0; // surrogate
+                return 3;
+            }
+            if (lead >= 0xF0 && lead <= 0xF4)
+            {
+                if (!continuation(1) || !continuation(2) || !continuation(3)) return 0;
+                if (lead == 0xF0 && byte(1) < 0x90) return 0; // overlong
+                if (lead == 0xF4 && byte(1) > 0x8F) return 0; // above U+10FFFF
+                return 4;
+            }
+            return 0;
+        }
+    }
+
+    class Writer
+    {
+        std::string& out;
+
+    public:
+        explicit Writer(std::string& out)
+            : out(out)
+        {}
+
+        void write(bool value)
+        {
+            out += value ? "true" : "false";
+        }
+
+        template<typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+        void write(T value)
+        {
+            char buffer[24];
+            auto [end, ec] = std::to_chars(std::begin(buffer), std::end(buffer), value);
+            out.append(buffer, end);
+        }
+
+        // Without this a float would quietly convert to bool. Written the
+        // shortest way that reads back the same, with ".0" kept on whole
+        // numbers and NaN and infinities as null, like dump(). A float is
+        // widened first, as nlohmann::json stores it as a double.
+        template<typename T, std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+        void write(T value)
+        {
+            if (!std::isfinite(value))
+            {
+                out += "null";
+                return;
+            }
+
+            char buffer[32];
+            auto [end, ec] = std::to_chars(std::begin(buffer), std::end(buffer), static_cast<double>(value));
+            std::string_view text{buffer, static_cast<std::size_t>(end - buffer)};
+            out += text;
+            if (text.find_first_of(".e") == std::string_view::npos)
+                out += ".0";
+        }
+
+        template<typename T, std::enable_if_t<std::is_enum_v<T>, int> = 0>
+        void write(T value)
+        {
+            write(static_cast<std::underlying_type_t<T>>(value));
+        }
+
+        // Invalid UTF-8 is written as U+FFFD, where dump() would throw.
+        void write(std::string_view value)
+        {
+            static constexpr char hex[] = "0123456789abcdef";
+
+            out += '"';
+            std::size_t start = 0;
+            for (std::size_t a = 0; a < value.size();)
+            {
+                auto letter = static_cast<unsigned char>(value[a]);
+                if (letter >= 0x20 && letter != '"' && letter != '\\' && letter < 0x80)
+                {
+                    a++;
+                    continue;
+                }
+
+                std::size_t length = letter < 0x80 ? 1 : detail::utf8_length(value.substr(a));
+                if (length > 1)
+                {
+                    a += length;
+                    continue;
+                }
+
+                out.append(value.data() + start, a - start);
+                switch (letter)
+                {
+                case '"' : out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\b': out += "\\b" ; break;
+                case '\f': out += "\\f" ; break;
+                case '\n': out += "\\n" ; break;
+                case '\r': out += "\\r" ; break;
+                case '\t': out += "\\t" ; break;
+                default:
+                    if (letter < 0x20)
+                    {
+                        out += "\\u00";
+                        out += hex[letter >> 4];
+                        out += hex[letter & 0xF];
+                    }
+                    else
+                    {
+                        out += "\xEF\xBF\xBD";
+                    }
+                    break;
+                }
+                start = ++a;
+            }
+            out.append(value.data() + start, value.size() - start);
+            out += '"';
+        }
+
+        void write(const std::string& value)
+        {
+            write(std::string_view{value});
+        }
+
+        void write(const char* value)
+        {
+            write(std::string_view{value});
+        }
+
+        template<typename T>
+        void write(const std::optional<T>& value)
+        {
+            if (value)
+                write(*value);
+            else
+                out += "null";
+        }
+
+        template<typename T>
+        void write(const std::vector<T>& value)
+        {
+            out += '[';
+            for (std::size_t a = 0; a < value.size(); a++)
+            {
+                if (a != 0)
+                    out += ',';
+                write(value[a]);
+            }
+            out += ']';
+        }
+
+        template<typename T, std::enable_if_t<Bakaneko::is_reflected_v<T>, int> = 0>
+        void write(const T& value)
+        {
+            out += '{';
+            bool first = true;
+            visit_fields(value, [this, &first](std::string_view name, const auto& field) {
+                if (!first)
+                    out += ',';
+                first = false;
+                write(name);
+                out += ':';
+                write(field);
+            });
+            out += '}';
+        }
+    };
+
+    template<typename T>
+    void write(std::string& out, const T& value)
+    {
+        Writer{out}.write(value);
+    }
+
+    template<typename T>
+    std::string dump(const T& value)
+    {
+        std::string out;
+        write(out, value);
+        return out;
+    }
+}
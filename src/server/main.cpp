@@ -12,6 +12,18 @@
 
 #include "windows.hpp"
 #include "ini.hpp"
+#include "config.hpp"
+#include "executor.hpp"
+#include "traffic.hpp"
+#include "systemd.hpp"
+#include "runlevels.hpp"
+#include "host.hpp"
+#include "process.hpp"
+#include "credentials.hpp"
+#include "access_log.hpp"
+#if defined(LJH_TARGET_Linux)
+#include "packages.hpp"
+#endif
 
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
@@ -197,7 +209,7 @@ int main(int argc, const char* argv[])
     spdlog::set_default_logger(std::make_shared<spdlog::logger>("", std::begin(sinks), std::end(sinks)));
     spdlog::register_logger(std::make_shared<spdlog::logger>("networking", std::begin(sinks), std::end(sinks)));
 
-    spdlog::set_level(spdlog::level::debug);
+    spdlog::set_level(spdlog::level::info);
 
     try
     {
@@ -217,6 +229,17 @@ int main(int argc, const char* argv[])
                 exit(-2);
             }
 
+            config.load(ini_file);
+
+            // from_str() turns anything it doesn't know into off.
+            auto level = spdlog::level::from_str(config.log.level);
+            if (level == spdlog::level::off && config.log.level != "off")
+            {
+                spdlog::warn("Unknown log level '{}' under the log section, using info", config.log.level);
+                level = spdlog::level::info;
+            }
+            spdlog::set_level(level);
+
             auto& networking = ini_file["networking"];
             return std::make_tuple(
                 args.address.value_or(ini_file["networking"]["address"].get<std::string  >(DEFAULT_ADDRESS)),
@@ -246,6 +269,37 @@ int main(int argc, const char* argv[])
             spdlog::warn("Failed to get shutdown privilege. Power controls may not work.");
         }
 #endif
+        // Stops everything started below on the way out, including when
+        // binding the listener throws.
+        struct Shutdown
+        {
+            ~Shutdown()
+            {
+                Credentials::stop();
+                Process::stop();
+                Host::stop();
+                Runlevels::stop();
+                Systemd::stop();
+                Traffic::stop();
+                Executor::stop();
+                AccessLog::stop();
+            }
+        } shutdown;
+
+        AccessLog::start();
+        Executor::start(config.executor);
+        Traffic::start();
+        Systemd::start(io_service);
+        Runlevels::start(io_service);
+        Host::start(io_service);
+        Process::start(io_service);
+        Credentials::start(io_service);
+#if defined(LJH_TARGET_Linux)
+        // Looks for the package databases now rather than on the first
+        // /updates.
+        Packages::detected();
+#endif
+
         std::make_shared<Rest::Server>(io_service, asio::ip::tcp::endpoint{asio::ip::make_address(address), port})->run();
 
         std::vector<std::thread> thread;
@@ -275,22 +329,14 @@ int main(int argc, const char* argv[])
 #include <stdexcept>
 #include <string>
 #include <array>
-#include <filesystem>
-#include <fstream>
-
-#include <ljh/memory_mapped_file.hpp>
 
 #if defined(LJH_TARGET_Windows)
 #define popen _popen
 #define pclose _pclose
-#define re_stderr "NUL"
-#else
-#define re_stderr "/dev/null"
-#endif
 
 std::tuple<int, std::string> exec(const std::string& cmd)
 {
-    auto pipe = popen((cmd + " 2>" re_stderr).c_str(), "r");
+    auto pipe = popen((cmd + " 2>NUL").c_str(), "r");
     if (!pipe)
         throw std::runtime_error("popen() failed!");
 
@@ -301,33 +347,11 @@ std::tuple<int, std::string> exec(const std::string& cmd)
 
     return {pclose(pipe), result};
 }
-
-std::string read_file(std::filesystem::path file_path)
+#else
+// Shell syntax still works, the callers' commands rely on it.
+std::tuple<int, std::string> exec(const std::string& cmd)
 {
-    ljh::memory_mapped::file file(std::forward<decltype(file_path)>(file_path), ljh::memory_mapped::permissions::read);
-    try
-    {
-        ljh::memory_mapped::view view{file, ljh::memory_mapped::permissions::read, 0, file.size()};
-        return std::string{view.as<const char>(), file.size()};
-    }
-    catch (const ljh::memory_mapped::invalid_file& e)
-    {
-        std::ifstream in(file_path, std::ios::in | std::ios::binary);
-        if (in)
-        {
-            std::string contents;
-            in.seekg(0, std::ios::end);
-            contents.resize(in.tellg());
-            in.seekg(0, std::ios::beg);
-            in.read(std::data(contents), contents.size());
-            in.close();
-            
-            if (auto null_term = contents.find('\0'); null_term == 0)
-                return "";
-            else if (null_term != std::string::npos)
-                return contents.substr(0, null_term - 1);
-            return contents;
-        }
-        throw e;
-    }
-}
\ No newline at end of file
+    auto result = Process::run({"/bin/sh", "-c", cmd});
+    return {result.exit_code, std::move(result.out)};
+}
+#endif
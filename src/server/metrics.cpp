@@ -0,0 +1,293 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "metrics.hpp"
+
+#include <map>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include <spdlog/fmt/fmt.h>
+
+namespace
+{
+    constexpr std::size_t max_series = 64;
+    constexpr std::size_t other = max_series - 1;
+
+    // Upper bounds in seconds, +Inf comes after.
+    constexpr std::array<double, 13> bounds = {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+    constexpr std::array<std::string_view, 5> status_classes = {"1xx", "2xx", "3xx", "4xx", "5xx"};
+
+    // Only ever written by the thread owning the shard, so a load and a
+    // store are enough, no read-modify-write needed.
+    struct Cell
+    {
+        std::atomic<std::uint64_t> value{0};
+
+        void add(std::uint64_t amount)
+        {
+            value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+        std::uint64_t get() const
+        {
+            return value.load(std::memory_order_relaxed);
+        }
+    };
+
+    struct Histogram
+    {
+        std::array<Cell, bounds.size() + 1> buckets;
+        Cell nanoseconds;
+
+        void add(Metrics::clock::duration duration)
+        {
+            auto seconds = std::chrono::duration<double>(duration).count();
+            auto bucket = std::lower_bound(bounds.begin(), bounds.end(), seconds) - bounds.begin();
+            buckets[bucket].add(1);
+            nanoseconds.add(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+        }
+    };
+
+    struct Shard
+    {
+        std::array<Histogram, max_series> requests;
+        std::array<std::array<Cell, status_classes.size()>, max_series> statuses;
+        std::array<Cell, max_series> bytes;
+        std::array<Histogram, max_series> collectors;
+        std::array<Histogram, max_series> commands;
+
+        // Gauges are kept as two counters each, since the opening and the
+        // closing can happen on different threads.
+        Cell requests_started;
+        Cell requests_finished;
+        Cell connections_opened;
+        Cell connections_closed;
+    };
+
+    // Shards are never freed, a thread that's gone still counted.
+    std::mutex shards_lock;
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    Shard& shard()
+    {
+        thread_local Shard* mine = [] {
+            auto shard = std::make_unique<Shard>();
+            auto pointer = shard.get();
+            std::lock_guard guard{shards_lock};
+            shards.push_back(std::move(shard));
+            return pointer;
+        }();
+        return *mine;
+    }
+
+    std::string escape(std::string_view value)
+    {
+        std::string output;
+        output.reserve(value.size());
+        for (auto letter : value)
+        {
+            if (letter == '\\' || letter == '"')
+                output += '\\';
+            if (letter == '\n')
+                output += "\\n";
+            else
+                output += letter;
+        }
+        return output;
+    }
+
+    // Label sets, written out ready to go between the braces.
+    class Registry
+    {
+        mutable std::mutex lock;
+        std::vector<std::string> labels;
+        std::map<std::string, std::size_t, std::less<>> indices;
+        std::string overflow;
+
+    public:
+        explicit Registry(std::string overflow)
+            : overflow(std::move(overflow))
+        {}
+
+        Metrics::Series intern(std::string labels_)
+        {
+            std::lock_guard guard{lock};
+            if (auto found = indices.find(labels_); found != indices.end())
+                return {found->second};
+            if (labels.size() >= other)
+                return {other};
+            indices.emplace(labels_, labels.size());
+            labels.push_back(std::move(labels_));
+            return {labels.size() - 1};
+        }
+
+        // Everything interned so far, with the overflow last when it could
+        // have been used.
+        std::vector<std::pair<std::size_t, std::string>> list() const
+        {
+            std::lock_guard guard{lock};
+            std::vector<std::pair<std::size_t, std::string>> output;
+            for (std::size_t a = 0; a < labels.size(); a++)
+                output.emplace_back(a, labels[a]);
+            if (labels.size() >= other)
+                output.emplace_back(other, overflow);
+            return output;
+        }
+    };
+
+    Registry routes    {"method=\"other\",route=\"other\""};
+    Registry collectors{"method=\"other\",collector=\"other\""};
+    Registry commands  {"command=\"other\""};
+
+    void write_histogram(std::string& output, std::string_view name, std::string_view help, const Registry& registry, const std::vector<Shard*>& all, std::array<Histogram, max_series> Shard::* member)
+    {
+        fmt::format_to(std::back_inserter(output), "# HELP {} {}\n# TYPE {} histogram\n", name, help, name);
+        for (auto& [index, labels] : registry.list())
+        {
+            std::array<std::uint64_t, bounds.size() + 1> buckets{};
+            std::uint64_t nanoseconds = 0;
+            for (auto shard : all)
+            {
+                auto& histogram = ((*shard).*member)[index];
+                for (std::size_t a = 0; a < buckets.size(); a++)
+                    buckets[a] += histogram.buckets[a].get();
+                nanoseconds += histogram.nanoseconds.get();
+            }
+
+            std::uint64_t count = 0;
+            for (std::size_t a = 0; a < buckets.size(); a++)
+            {
+                count += buckets[a];
+                if (a < bounds.size())
+                    fmt::format_to(std::back_inserter(output), "{}_bucket{{{},le=\"{}\"}} {}\n", name, labels, bounds[a], count);
+                else
+                    fmt::format_to(std::back_inserter(output), "{}_bucket{{{},le=\"+Inf\"}} {}\n", name, labels, count);
+            }
+            fmt::format_to(std::back_inserter(output), "{}_sum{{{}}} {}\n", name, labels, nanoseconds / 1e9);
+            fmt::format_to(std::back_inserter(output), "{}_count{{{}}} {}\n", name, labels, count);
+        }
+    }
+}
+
+Metrics::Series Metrics::route(std::string_view method, std::string_view path)
+{
+    return routes.intern(fmt::format("method=\"{}\",route=\"{}\"", escape(method), escape(path)));
+}
+
+Metrics::Series Metrics::collector(std::string_view method, std::string_view route)
+{
+    return collectors.intern(fmt::format("method=\"{}\",collector=\"{}\"", escape(method), escape(route)));
+}
+
+Metrics::Series Metrics::command(std::string_view name)
+{
+    return commands.intern(fmt::format("command=\"{}\"", escape(name)));
+}
+
+void Metrics::request_started()
+{
+    shard().requests_started.add(1);
+}
+
+void Metrics::request_finished(Series route, unsigned status, std::size_t bytes, clock::duration duration)
+{
+    auto& mine = shard();
+    auto status_class = std::clamp<std::size_t>(status / 100, 1, status_classes.size()) - 1;
+    mine.requests[route.index].add(duration);
+    mine.statuses[route.index][status_class].add(1);
+    mine.bytes[route.index].add(bytes);
+    mine.requests_finished.add(1);
+}
+
+void Metrics::request_dropped()
+{
+    shard().requests_finished.add(1);
+}
+
+void Metrics::connection_opened()
+{
+    shard().connections_opened.add(1);
+}
+
+void Metrics::connection_closed()
+{
+    shard().connections_closed.add(1);
+}
+
+void Metrics::collected(Series collector, clock::duration duration)
+{
+    shard().collectors[collector.index].add(duration);
+}
+
+void Metrics::ran(Series command, clock::duration duration)
+{
+    shard().commands[command.index].add(duration);
+}
+
+std::string Metrics::render()
+{
+    std::vector<Shard*> all;
+    {
+        std::lock_guard guard{shards_lock};
+        for (auto& shard : shards)
+            all.push_back(shard.get());
+    }
+
+    auto sum = [&all](Cell Shard::* member) {
+        std::uint64_t total = 0;
+        for (auto shard : all)
+            total += ((*shard).*member).get();
+        return total;
+    };
+    // The two halves are read at slightly different times, so a gauge can
+    // be off by whatever changed in between, but never below zero.
+    auto difference = [](std::uint64_t up, std::uint64_t down) {
+        return up > down ? up - down : 0;
+    };
+
+    std::string output;
+    auto out = std::back_inserter(output);
+
+    fmt::format_to(out, "# HELP bakaneko_http_requests_total Requests answered, by route and status class.\n# TYPE bakaneko_http_requests_total counter\n");
+    for (auto& [index, labels] : routes.list())
+    {
+        for (std::size_t a = 0; a < status_classes.size(); a++)
+        {
+            std::uint64_t total = 0;
+            for (auto shard : all)
+                total += shard->statuses[index][a].get();
+            if (total != 0)
+                fmt::format_to(out, "bakaneko_http_requests_total{{{},code=\"{}\"}} {}\n", labels, status_classes[a], total);
+        }
+    }
+
+    write_histogram(output, "bakaneko_http_request_duration_seconds", "Time from reading a request to having written its response.", routes, all, &Shard::requests);
+
+    fmt::format_to(out, "# HELP bakaneko_http_response_bytes_total Bytes written in responses, headers included.\n# TYPE bakaneko_http_response_bytes_total counter\n");
+    for (auto& [index, labels] : routes.list())
+    {
+        std::uint64_t total = 0;
+        for (auto shard : all)
+            total += shard->bytes[index].get();
+        fmt::format_to(out, "bakaneko_http_response_bytes_total{{{}}} {}\n", labels, total);
+    }
+
+    fmt::format_to(out, "# HELP bakaneko_http_requests_in_flight Requests read and not yet answered.\n# TYPE bakaneko_http_requests_in_flight gauge\n");
+    fmt::format_to(out, "bakaneko_http_requests_in_flight {}\n", difference(sum(&Shard::requests_started), sum(&Shard::requests_finished)));
+
+    fmt::format_to(out, "# HELP bakaneko_http_connections_open HTTP connections open, not counting upgraded /stream ones.\n# TYPE bakaneko_http_connections_open gauge\n");
+    fmt::format_to(out, "bakaneko_http_connections_open {}\n", difference(sum(&Shard::connections_opened), sum(&Shard::connections_closed)));
+    fmt::format_to(out, "# HELP bakaneko_http_connections_total HTTP connections accepted.\n# TYPE bakaneko_http_connections_total counter\n");
+    fmt::format_to(out, "bakaneko_http_connections_total {}\n", sum(&Shard::connections_opened));
+
+    write_histogram(output, "bakaneko_collector_duration_seconds", "Time spent inside a collector, cache hits not included.", collectors, all, &Shard::collectors);
+    write_histogram(output, "bakaneko_process_duration_seconds", "Time from starting a command to it having exited.", commands, all, &Shard::commands);
+
+    return output;
+}
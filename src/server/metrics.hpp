@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <cstddef>
+#include <string_view>
+
+// Counters for /metrics, written out in the Prometheus text format. Every
+// thread records into its own shard with plain relaxed stores, so nothing
+// on the request path waits on anything. A scrape adds the shards up.
+namespace Metrics
+{
+    using clock = std::chrono::steady_clock;
+
+    // A label set things are recorded under. Making one takes a lock, so
+    // call sites keep theirs in a static. Past 64 of a kind, the rest share
+    // one labelled "other".
+    struct Series
+    {
+        std::size_t index;
+    };
+
+    Series route    (std::string_view method, std::string_view path);
+    Series collector(std::string_view method, std::string_view route);
+    Series command  (std::string_view name);
+
+    // A request from the moment it was read until its response was
+    // written, bytes counting the headers too.
+    void request_started();
+    void request_finished(Series route, unsigned status, std::size_t bytes, clock::duration duration);
+    // A request whose connection went away before it was answered.
+    void request_dropped();
+
+    void connection_opened();
+    void connection_closed();
+
+    // Time spent inside a collector or waiting on a child process.
+    void collected(Series collector, clock::duration duration);
+    void ran      (Series command  , clock::duration duration);
+
+    std::string render();
+}
@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+
+#include "reflection.hpp"
+
+// Writes Bakaneko types as MessagePack, the binary twin of Json::Writer.
+// Structs become maps keyed by field name, so nlohmann::json::from_msgpack()
+// on the other end yields the same value as parsing the JSON would. Every
+// value uses the smallest encoding that fits it.
+namespace Msgpack
+{
+    class Writer
+    {
+        std::string& out;
+
+        void put(std::uint8_t byte)
+        {
+            out += static_cast<char>(byte);
+        }
+
+        template<typename T>
+        void put_big_endian(std::uint8_t marker, T value)
+        {
+            put(marker);
+            for (int shift = (sizeof(T) - 1) * 8; shift >= 0; shift -= 8)
+                put(static_cast<std::uint8_t>(static_cast<std::make_unsigned_t<T>>(value) >> shift));
+        }
+
+        // fix is the fixed-size marker with its length bits cleared (or 0 if
+        // the type has none), fix_max the largest length it holds.
+        void put_length(std::size_t length, std::uint8_t fix, std::size_t fix_max, std::uint8_t marker8, std::uint8_t marker16, std::uint8_t marker32)
+        {
+            if (fix != 0 && length <= fix_max)
+                put(static_cast<std::uint8_t>(fix | length));
+            else if (marker8 != 0 && length <= UINT8_MAX)
+                put_big_endian(marker8, static_cast<std::uint8_t>(length));
+            else if (length <= UINT16_MAX)
+                put_big_endian(marker16, static_cast<std::uint16_t>(length));
+            else
+                put_big_endian(marker32, static_cast<std::uint32_t>(length));
+        }
+
+    public:
+        explicit Writer(std::string& out)
+            : out(out)
+        {}
+
+        void write(bool value)
+        {
+            put(value ? 0xc3 : 0xc2);
+        }
+
+        template<typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+        void write(T value)
+        {
+            if constexpr (std::is_signed_v<T>)
+            {
+                if (value < 0)
+                {
+                    if      (value >= -32        ) put(static_cast<std::uint8_t>(value));
+                    else if (value >= INT8_MIN   ) put_big_endian(0xd0, static_cast<std::int8_t >(value));
+                    else if (value >= INT16_MIN  ) put_big_endian(0xd1, static_cast<std::int16_t>(value));
+                    else if (value >= INT32_MIN  ) put_big_endian(0xd2, static_cast<std::int32_t>(value));
+                    else                           put_big_endian(0xd3, static_cast<std::int64_t>(value));
+                    return;
+                }
+            }
+
+            auto number = static_cast<std::uint64_t>(value);
+            if      (number <= 0x7f      ) put(static_cast<std::uint8_t>(number));
+            else if (number <= UINT8_MAX ) put_big_endian(0xcc, static_cast<std::uint8_t >(number));
+            else if (number <= UINT16_MAX) put_big_endian(0xcd, static_cast<std::uint16_t>(number));
+            else if (number <= UINT32_MAX) put_big_endian(0xce, static_cast<std::uint32_t>(number));
+            else                           put_big_endian(0xcf, number);
+        }
+
+        // Always a float 64, a float is widened first like nlohmann::json
+        // does, so both read back as the same double.
+        template<typename T, std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+        void write(T value)
+        {
+            auto number = static_cast<double>(value);
+            std::uint64_t bits;
+            std::memcpy(&bits, &number, sizeof(bits));
+            put_big_endian(0xcb, bits);
+        }
+
+        template<typename T, std::enable_if_t<std::is_enum_v<T>, int> = 0>
+        void write(T value)
+        {
+            write(static_cast<std::underlying_type_t<T>>(value));
+        }
+
+        void write(std::string_view value)
+        {
+            put_length(value.size(), 0xa0, 31, 0xd9, 0xda, 0xdb);
+            out.append(value.data(), value.size());
+        }
+
+        void write(const std::string& value)
+        {
+            write(std::string_view{value});
+        }
+
+        void write(const char* value)
+        {
+            write(std::string_view{value});
+        }
+
+        template<typename T>
+        void write(const std::optional<T>& value)
+        {
+            if (value)
+                write(*value);
+            else
+                put(0xc0);
+        }
+
+        template<typename T>
+        void write(const std::vector<T>& value)
+        {
+            put_length(value.size(), 0x90, 15, 0, 0xdc, 0xdd);
+            for (auto& item : value)
+                write(item);
+        }
+
+        template<typename T, std::enable_if_t<Bakaneko::is_reflected_v<T>, int> = 0>
+        void write(const T& value)
+        {
+            put_length(field_count(static_cast<const T*>(nullptr)), 0x80, 15, 0, 0xde, 0xdf);
+            visit_fields(value, [this](std::string_view name, const auto& field) {
+                write(name);
+                write(field);
+            });
+        }
+    };
+
+    template<typename T>
+    void write(std::string& out, const T& value)
+    {
+        Writer{out}.write(value);
+    }
+
+    template<typename T>
+    std::string dump(const T& value)
+    {
+        std::string out;
+        write(out, value);
+        return out;
+    }
+}
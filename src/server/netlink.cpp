@@ -0,0 +1,235 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "netlink.hpp"
+
+#include <ljh/system_info.hpp>
+
+#if defined(LJH_TARGET_Linux)
+#include <map>
+#include <array>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if.h>
+#include <linux/if_link.h>
+#include <spdlog/fmt/fmt.h>
+
+namespace
+{
+    [[noreturn]] void fail(const char* what, int error = errno)
+    {
+        throw std::system_error(error, std::generic_category(), what);
+    }
+
+    class Socket
+    {
+        int fd;
+        uint32_t sequence = 0;
+
+    public:
+        Socket()
+            : fd(socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE))
+        {
+            if (fd < 0)
+                fail("netlink socket");
+        }
+
+        ~Socket()
+        {
+            close(fd);
+        }
+
+        Socket(const Socket&) = delete;
+        Socket& operator=(const Socket&) = delete;
+
+        // Sends a dump request and calls handle() for every reply message.
+        template <typename Body, typename Handle>
+        void dump(uint16_t request_type, uint16_t reply_type, Handle&& handle)
+        {
+            struct
+            {
+                nlmsghdr header;
+                Body body;
+            } request{};
+            request.header.nlmsg_len   = NLMSG_LENGTH(sizeof(Body));
+            request.header.nlmsg_type  = request_type;
+            request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+            request.header.nlmsg_seq   = ++sequence;
+
+            sockaddr_nl kernel{};
+            kernel.nl_family = AF_NETLINK;
+            if (sendto(fd, &request, request.header.nlmsg_len, 0, reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel)) < 0)
+                fail("netlink send");
+
+            // Dump replies are batched up to about a page per message, 32KiB
+            // holds several without truncating any.
+            alignas(nlmsghdr) std::array<char, 32 * 1024> buffer;
+            for (;;)
+            {
+                auto received = recv(fd, buffer.data(), buffer.size(), 0);
+                if (received < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    fail("netlink recv");
+                }
+
+                auto length = static_cast<unsigned int>(received);
+                for (auto header = reinterpret_cast<nlmsghdr*>(buffer.data()); NLMSG_OK(header, length); header = NLMSG_NEXT(header, length))
+                {
+                    if (header->nlmsg_seq != sequence)
+                        continue;
+                    if (header->nlmsg_type == NLMSG_DONE)
+                        return;
+                    if (header->nlmsg_type == NLMSG_ERROR)
+                    {
+                        auto error = static_cast<nlmsgerr*>(NLMSG_DATA(header));
+                        fail("netlink dump", -error->error);
+                    }
+                    if (header->nlmsg_type == reply_type)
+                        handle(header);
+                }
+            }
+        }
+    };
+
+    std::string mac(const rtattr* attribute)
+    {
+        auto bytes = static_cast<const unsigned char*>(RTA_DATA(attribute));
+        std::string text;
+        for (std::size_t i = 0; i < RTA_PAYLOAD(attribute); i++)
+            text += fmt::format(i ? ":{:02x}" : "{:02x}", bytes[i]);
+        return text;
+    }
+}
+
+std::vector<Netlink::Link> Netlink::links()
+{
+    Socket socket;
+
+    std::vector<Link> links;
+    std::map<int, std::size_t> by_index;
+
+    socket.dump<ifinfomsg>(RTM_GETLINK, RTM_NEWLINK, [&](const nlmsghdr* header) {
+        auto info = static_cast<const ifinfomsg*>(NLMSG_DATA(header));
+        Link link;
+        link.index = info->ifi_index;
+        link.type  = info->ifi_type;
+
+        bool stats64 = false;
+        auto length = IFLA_PAYLOAD(header);
+        for (auto attribute = IFLA_RTA(info); RTA_OK(attribute, length); attribute = RTA_NEXT(attribute, length))
+        {
+            switch (attribute->rta_type)
+            {
+            case IFLA_IFNAME:
+                link.name = static_cast<const char*>(RTA_DATA(attribute));
+                break;
+            case IFLA_MTU:
+                std::memcpy(&link.mtu, RTA_DATA(attribute), sizeof(link.mtu));
+                break;
+            case IFLA_ADDRESS:
+                link.mac_address = mac(attribute);
+                break;
+            case IFLA_OPERSTATE:
+                link.up = *static_cast<const uint8_t*>(RTA_DATA(attribute)) == IF_OPER_UP;
+                break;
+            case IFLA_STATS64:
+            {
+                rtnl_link_stats64 stats{};
+                std::memcpy(&stats, RTA_DATA(attribute), std::min<std::size_t>(sizeof(stats), RTA_PAYLOAD(attribute)));
+                link.bytes_rx = stats.rx_bytes;
+                link.bytes_tx = stats.tx_bytes;
+                stats64 = true;
+                break;
+            }
+            case IFLA_STATS:
+                if (!stats64)
+                {
+                    rtnl_link_stats stats{};
+                    std::memcpy(&stats, RTA_DATA(attribute), std::min<std::size_t>(sizeof(stats), RTA_PAYLOAD(attribute)));
+                    link.bytes_rx = stats.rx_bytes;
+                    link.bytes_tx = stats.tx_bytes;
+                }
+                break;
+            case IFLA_LINKINFO:
+            {
+                auto nested_length = RTA_PAYLOAD(attribute);
+                for (auto nested = static_cast<const rtattr*>(RTA_DATA(attribute)); RTA_OK(nested, nested_length); nested = RTA_NEXT(nested, nested_length))
+                {
+                    if (nested->rta_type == IFLA_INFO_KIND)
+                        link.kind = static_cast<const char*>(RTA_DATA(nested));
+                }
+                break;
+            }
+            }
+        }
+
+        by_index.emplace(link.index, links.size());
+        links.push_back(std::move(link));
+    });
+
+    socket.dump<ifaddrmsg>(RTM_GETADDR, RTM_NEWADDR, [&](const nlmsghdr* header) {
+        auto info = static_cast<const ifaddrmsg*>(NLMSG_DATA(header));
+        auto link = by_index.find(static_cast<int>(info->ifa_index));
+        if (link == by_index.end() || (info->ifa_family != AF_INET && info->ifa_family != AF_INET6))
+            return;
+
+        // On point-to-point links IFA_ADDRESS is the peer's, IFA_LOCAL ours.
+        const rtattr* address = nullptr;
+        auto length = IFA_PAYLOAD(header);
+        for (auto attribute = IFA_RTA(info); RTA_OK(attribute, length); attribute = RTA_NEXT(attribute, length))
+        {
+            if (attribute->rta_type == IFA_LOCAL || (attribute->rta_type == IFA_ADDRESS && address == nullptr))
+                address = attribute;
+        }
+        if (address == nullptr)
+            return;
+
+        char text[INET6_ADDRSTRLEN] = {};
+        if (inet_ntop(info->ifa_family, RTA_DATA(address), text, sizeof(text)) == nullptr)
+            return;
+
+        auto& target = links[link->second];
+        (info->ifa_family == AF_INET ? target.ipv4 : target.ipv6).emplace_back(text);
+    });
+
+    return links;
+}
+
+int Netlink::subscribe(uint32_t groups)
+{
+    auto fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+    if (fd < 0)
+        fail("netlink socket");
+
+    sockaddr_nl local{};
+    local.nl_family = AF_NETLINK;
+    local.nl_groups = groups;
+    if (bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0)
+    {
+        auto error = errno;
+        close(fd);
+        fail("netlink bind", error);
+    }
+    return fd;
+}
+#else
+std::vector<Netlink::Link> Netlink::links()
+{
+    return {};
+}
+
+int Netlink::subscribe(uint32_t groups)
+{
+    return -1;
+}
+#endif
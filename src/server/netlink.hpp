@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Every network interface and its addresses from one RTM_GETLINK and one
+// RTM_GETADDR dump over a rtnetlink socket, instead of half a dozen sysfs
+// files and an ioctl per interface. Linux only.
+namespace Netlink
+{
+    struct Link
+    {
+        int index = 0;
+        std::string name;
+        unsigned short type = 0; // ARPHRD_*
+        std::string kind;        // IFLA_INFO_KIND ("veth", "bridge", ...), empty for hardware
+        bool up = false;         // Operational state is up
+        uint32_t mtu = 0;
+        std::string mac_address;
+        uint64_t bytes_rx = 0;
+        uint64_t bytes_tx = 0;
+        std::vector<std::string> ipv4;
+        std::vector<std::string> ipv6;
+    };
+
+    // In interface index order. Throws std::system_error if the kernel
+    // can't be asked.
+    std::vector<Link> links();
+
+    // A non-blocking rtnetlink socket that receives the notifications of
+    // the RTMGRP_* groups given, for the caller to read and close. Throws
+    // std::system_error.
+    int subscribe(uint32_t groups);
+}
@@ -2,8 +2,12 @@
 // SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
 
 #include "info.hpp"
+#include "config.hpp"
+#include "traffic.hpp"
 
 #include <filesystem>
+#include <optional>
+#include <cstdlib>
 #include <chrono>
 
 #include <ljh/system_info.hpp>
@@ -18,16 +22,28 @@
 #include <netioapi.h>
 #include "windows.hpp"
 #elif defined(LJH_TARGET_Linux)
-#include <unistd.h>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <sys/ioctl.h>
-#include <netinet/in.h>
-#include <net/if.h>
-#include <arpa/inet.h>
+#include <net/if_arp.h>
+#include "netlink.hpp"
+#include "sysfs.hpp"
 #endif
 
-extern std::string read_file(std::filesystem::path file_path);
+
+// Fills in the counters and rates from the background sampler, false if it
+// hasn't sampled the adapter (yet).
+static bool sampled(Bakaneko::Adapter &adapter)
+{
+    auto sample = Traffic::latest(adapter.name);
+    if (!sample)
+        return false;
+
+    adapter.time = sample->time;
+    adapter.bytes_rx = sample->bytes_rx;
+    adapter.bytes_tx = sample->bytes_tx;
+    adapter.rx_rate = sample->rx_rate;
+    adapter.tx_rate = sample->tx_rate;
+    adapter.interval = sample->interval;
+    return true;
+}
 
 ljh::expected<Bakaneko::Adapters, Errors> Info::Adapters(const Fields &fields)
 {
@@ -66,51 +82,82 @@ ljh::expected<Bakaneko::Adapters, Errors> Info::Adapters(const Fields &fields)
         adapter.bytes_tx = (item.OutOctets);
         adapter.mtu = (item.Mtu);
         adapter.link_speed = (item.TransmitLinkSpeed);
+        sampled(adapter);
     }
 #elif defined(LJH_TARGET_Linux)
-    for (auto &adapter_file : std::filesystem::directory_iterator{"/sys/class/net"})
+    auto time = std::chrono::steady_clock::now();
+    for (auto &link : Netlink::links())
     {
-        auto adapter_path = adapter_file.path();
-        if (!std::filesystem::exists(adapter_path / "type"))
-            continue;
-        if (read_file(adapter_path / "type") == "772")
+        if (link.type == ARPHRD_LOOPBACK)
             continue;
         auto &adapter = adapters.adapters.emplace_back();
 
-        adapter.name = (adapter_path.filename().string());
-
-        adapter.mac_address = (read_file(adapter_path / "address"));
+        adapter.name = (link.name);
+        adapter.mac_address = (link.mac_address);
+        adapter.mtu = (link.mtu);
 
-        auto state = read_file(adapter_path / "operstate");
-        if (state == "up")
+        adapter.addresses = link.ipv4;
+        adapter.addresses.insert(adapter.addresses.end(), link.ipv6.begin(), link.ipv6.end());
+        if (link.up)
         {
             adapter.state = (Bakaneko::Adapter::State::Up);
-
-            auto fd = socket(AF_INET, SOCK_DGRAM, 0);
-            struct ifreq ifr;
-            ifr.ifr_addr.sa_family = AF_INET;
-            strncpy(ifr.ifr_name, adapter_path.filename().c_str(), IFNAMSIZ);
-            ioctl(fd, SIOCGIFADDR, &ifr);
-            close(fd);
-
-            adapter.ip_address = (inet_ntoa(((struct sockaddr_in *)&ifr.ifr_addr)->sin_addr));
+            if (!link.ipv4.empty())
+                adapter.ip_address = (link.ipv4.front());
         }
 
-        auto rx = read_file(adapter_path / "statistics" / "rx_bytes");
-        auto tx = read_file(adapter_path / "statistics" / "tx_bytes");
-        auto time = std::chrono::steady_clock::now();
-
-        adapter.time = (time.time_since_epoch().count());
-        adapter.bytes_rx = (std::stoull(rx));
-        adapter.bytes_tx = (std::stoull(tx));
-
-        adapter.mtu = (std::stoull(read_file(adapter_path / "mtu")));
+        if (!sampled(adapter))
+        {
+            adapter.time = (time.time_since_epoch().count());
+            adapter.bytes_rx = (link.bytes_rx);
+            adapter.bytes_tx = (link.bytes_tx);
+        }
 
-        if (auto speed = read_file(adapter_path / "speed"); !speed.empty() && speed != "-1")
-            adapter.link_speed = (std::stoull(speed) * 1000000);
+        // Netlink doesn't carry the link speed. Virtual links (the ones with
+        // a kind) don't have a real one, so only hardware that is up is asked.
+        if (link.up && link.kind.empty())
+        {
+            // -1 while the speed is unknown.
+            if (auto speed = Sysfs::number<int64_t>(std::filesystem::path{"/sys/class/net"} / link.name / "speed"); speed && *speed > 0)
+                adapter.link_speed = (*speed * 1000000);
+        }
     }
 #else
     return ljh::unexpected{Errors::NotImplemented};
 #endif
     return adapters;
+}
+
+ljh::expected<Bakaneko::AdaptersHistory, Errors> Info::AdaptersHistory(const Fields &fields)
+{
+    if (!Traffic::running())
+        return ljh::unexpected{Errors::NotImplemented};
+
+    Bakaneko::AdaptersHistory history;
+    history.interval = std::chrono::duration_cast<std::chrono::nanoseconds>(config.adapters.interval).count();
+
+    // ?adapter=eth0 for just the one, ?seconds=60 for just the last minute.
+    std::optional<std::string_view> only;
+    if (auto adapter = fields.query.find("adapter"); adapter != fields.query.end())
+        only = adapter->second;
+
+    uint64_t since = 0;
+    if (auto seconds = fields.query.find("seconds"); seconds != fields.query.end())
+    {
+        auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch());
+        auto window = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>{std::strtod(seconds->second.c_str(), nullptr)});
+        if (window.count() > 0 && window < now)
+            since = (now - window).count();
+    }
+
+    for (auto &name : Traffic::adapters())
+    {
+        if (only && *only != name)
+            continue;
+
+        auto &adapter = history.adapters.emplace_back();
+        adapter.name = name;
+        for (auto &sample : Traffic::history(name, since))
+            adapter.samples.push_back({sample.time, sample.bytes_rx, sample.bytes_tx, sample.rx_rate, sample.tx_rate});
+    }
+    return history;
 }
\ No newline at end of file
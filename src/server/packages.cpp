@@ -0,0 +1,878 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "packages.hpp"
+#include "compression.hpp"
+
+#include <map>
+#include <string>
+#include <cstdint>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+
+#include <ljh/memory_mapped_file.hpp>
+
+#include <spdlog/spdlog.h>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    bool starts_with(std::string_view text, std::string_view prefix) { return text.substr(0, prefix.size()) == prefix; }
+    bool ends_with  (std::string_view text, std::string_view suffix) { return text.size() >= suffix.size() && text.substr(text.size() - suffix.size()) == suffix; }
+
+    bool is_digit(int c) { return c >= '0' && c <= '9'; }
+    bool is_alpha(int c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+    bool is_alnum(int c) { return is_digit(c) || is_alpha(c); }
+
+    // Character at i, or '\0' past the end like the C strings these algorithms were written for.
+    int at(std::string_view text, std::size_t i) { return i < text.size() ? static_cast<unsigned char>(text[i]) : '\0'; }
+
+    // A whole file mapped read-only, empty when it can't be.
+    class Mapped
+    {
+        ljh::memory_mapped::file file;
+        ljh::memory_mapped::view view;
+        std::string_view contents;
+
+    public:
+        explicit Mapped(fs::path path)
+        {
+            try
+            {
+                file = ljh::memory_mapped::file{std::move(path), ljh::memory_mapped::permissions::read};
+                if (file.size() != 0)
+                {
+                    view = ljh::memory_mapped::view{file, ljh::memory_mapped::permissions::read, 0, file.size()};
+                    contents = {view.as<const char>(), file.size()};
+                }
+            }
+            catch (const ljh::memory_mapped::io_error&)
+            {
+            }
+        }
+
+        std::string_view text() const { return contents; }
+    };
+
+    // A mapped index, inflated first when it is gzipped. Any other compression
+    // leaves it unreadable.
+    class Index
+    {
+        Mapped mapped;
+        std::string inflated;
+        bool readable = true;
+
+    public:
+        explicit Index(fs::path path)
+            : mapped(std::move(path))
+        {
+            auto text = mapped.text();
+            if (starts_with(text, "\x1f\x8b"))
+            {
+                try
+                {
+                    inflated = Compression::decompress(text);
+                }
+                catch (const std::exception&)
+                {
+                    readable = false;
+                }
+            }
+            else if (starts_with(text, "\x28\xb5\x2f\xfd") || starts_with(text, "\xfd" "7zXZ") || starts_with(text, "\x04\x22\x4d\x18") || starts_with(text, "BZh"))
+            {
+                readable = false;
+            }
+        }
+
+        bool ok() const { return readable; }
+        std::string_view text() const { return inflated.empty() ? mapped.text() : std::string_view{inflated}; }
+    };
+
+    // Splits off the next line, without its line ending.
+    std::string_view next_line(std::string_view& text)
+    {
+        auto eol = text.find('\n');
+        auto line = text.substr(0, eol);
+        text = eol == std::string_view::npos ? std::string_view{} : text.substr(eol + 1);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        return line;
+    }
+
+    // Walks "Key: value" paragraphs separated by blank lines, the layout of
+    // dpkg's status, apt's Packages lists and apk's databases ("K:value").
+    // Calls field() for each line and end() after each paragraph.
+    template <typename Field, typename End>
+    void paragraphs(std::string_view text, Field&& field, End&& end)
+    {
+        bool open = false;
+        while (!text.empty())
+        {
+            auto line = next_line(text);
+            if (line.empty())
+            {
+                if (open)
+                    end();
+                open = false;
+                continue;
+            }
+            // Continuation of a multi-line value.
+            if (line.front() == ' ' || line.front() == '\t')
+                continue;
+
+            auto colon = line.find(':');
+            if (colon == std::string_view::npos)
+                continue;
+
+            auto value = line.substr(colon + 1);
+            while (!value.empty() && value.front() == ' ')
+                value.remove_prefix(1);
+            field(line.substr(0, colon), value);
+            open = true;
+        }
+        if (open)
+            end();
+    }
+
+    // Calls entry(name, contents) for each regular file in a tar archive.
+    // Zero blocks are skipped rather than ending it, apk indexes are several
+    // archives back to back.
+    template <typename Entry>
+    void tar(std::string_view archive, Entry&& entry)
+    {
+        constexpr std::size_t block = 512;
+        std::string name;
+        while (archive.size() >= block)
+        {
+            auto header = archive.substr(0, block);
+            if (header[0] == '\0')
+            {
+                archive.remove_prefix(block);
+                continue;
+            }
+            auto field = [header](std::size_t offset, std::size_t length) {
+                auto value = header.substr(offset, length);
+                return value.substr(0, value.find('\0'));
+            };
+
+            std::uint64_t size = 0;
+            for (char c : field(124, 12))
+            {
+                if (c >= '0' && c <= '7')
+                    size = size * 8 + (c - '0');
+            }
+
+            name = field(0, 100);
+            if (auto prefix = field(345, 155); starts_with(field(257, 6), "ustar") && !prefix.empty())
+                name = std::string{prefix} + '/' + name;
+
+            archive.remove_prefix(block);
+            auto contents = archive.substr(0, size);
+            if (auto type = header[156]; type == '0' || type == '\0')
+                entry(std::string_view{name}, contents);
+            archive.remove_prefix(std::min<std::size_t>(archive.size(), (size + block - 1) / block * block));
+        }
+    }
+
+    // dpkg's verrevcmp(), for one of upstream version or revision.
+    int deb_order(int c)
+    {
+        if (is_digit(c))
+            return 0;
+        if (is_alpha(c))
+            return c;
+        if (c == '~')
+            return -1;
+        if (c)
+            return c + 256;
+        return 0;
+    }
+
+    int deb_compare(std::string_view a, std::string_view b)
+    {
+        std::size_t i = 0, j = 0;
+        while (i < a.size() || j < b.size())
+        {
+            while ((i < a.size() && !is_digit(at(a, i))) || (j < b.size() && !is_digit(at(b, j))))
+            {
+                int ac = deb_order(at(a, i));
+                int bc = deb_order(at(b, j));
+                if (ac != bc)
+                    return ac - bc;
+                i++;
+                j++;
+            }
+
+            while (at(a, i) == '0')
+                i++;
+            while (at(b, j) == '0')
+                j++;
+
+            int first_diff = 0;
+            while (is_digit(at(a, i)) && is_digit(at(b, j)))
+            {
+                if (!first_diff)
+                    first_diff = at(a, i) - at(b, j);
+                i++;
+                j++;
+            }
+            if (is_digit(at(a, i)))
+                return 1;
+            if (is_digit(at(b, j)))
+                return -1;
+            if (first_diff)
+                return first_diff;
+        }
+        return 0;
+    }
+
+    // libalpm's rpmvercmp(), for one of epoch, version or release.
+    int rpmvercmp(std::string_view a, std::string_view b)
+    {
+        if (a == b)
+            return 0;
+
+        std::size_t one = 0, two = 0;
+        while (one < a.size() && two < b.size())
+        {
+            auto separator_one = one, separator_two = two;
+            while (one < a.size() && !is_alnum(at(a, one)))
+                one++;
+            while (two < b.size() && !is_alnum(at(b, two)))
+                two++;
+            if (one >= a.size() || two >= b.size())
+                break;
+
+            // "1.0" is older than "1..0".
+            if (one - separator_one != two - separator_two)
+                return one - separator_one < two - separator_two ? -1 : 1;
+
+            bool numeric = is_digit(at(a, one));
+            auto same = [numeric](int c) { return numeric ? is_digit(c) : is_alpha(c); };
+            auto end_one = one, end_two = two;
+            while (end_one < a.size() && same(at(a, end_one)))
+                end_one++;
+            while (end_two < b.size() && same(at(b, end_two)))
+                end_two++;
+
+            auto segment_one = a.substr(one, end_one - one);
+            auto segment_two = b.substr(two, end_two - two);
+            // Segments of different types, numbers are newer.
+            if (segment_two.empty())
+                return numeric ? 1 : -1;
+
+            if (numeric)
+            {
+                segment_one.remove_prefix(std::min(segment_one.find_first_not_of('0'), segment_one.size()));
+                segment_two.remove_prefix(std::min(segment_two.find_first_not_of('0'), segment_two.size()));
+                if (segment_one.size() != segment_two.size())
+                    return segment_one.size() < segment_two.size() ? -1 : 1;
+            }
+            if (auto result = segment_one.compare(segment_two); result != 0)
+                return result < 0 ? -1 : 1;
+
+            one = end_one;
+            two = end_two;
+        }
+
+        if (one >= a.size() && two >= b.size())
+            return 0;
+        // A remaining letter segment ("1.0a") never beats nothing ("1.0"),
+        // anything else does.
+        if ((one >= a.size() && !is_alpha(at(b, two))) || is_alpha(at(a, one)))
+            return -1;
+        return 1;
+    }
+
+    struct ApkVersion
+    {
+        std::vector<std::uint64_t> numbers;
+        int letter = 0;
+        std::vector<std::pair<int, std::uint64_t>> suffixes;
+        std::uint64_t revision = 0;
+    };
+
+    // Pre-release suffixes order before the bare version, the rest after it.
+    int apk_suffix_rank(std::string_view suffix)
+    {
+        constexpr std::pair<std::string_view, int> ranks[] = {
+            {"alpha", -4}, {"beta", -3}, {"pre", -2}, {"rc", -1},
+            {"cvs", 1}, {"svn", 2}, {"git", 3}, {"hg", 4}, {"p", 5},
+        };
+        for (auto& [name, rank] : ranks)
+        {
+            if (name == suffix)
+                return rank;
+        }
+        return 0;
+    }
+
+    std::uint64_t take_number(std::string_view text, std::size_t& i)
+    {
+        std::uint64_t value = 0;
+        while (is_digit(at(text, i)))
+            value = value * 10 + (text[i++] - '0');
+        return value;
+    }
+
+    // 1.2.3b_rc1_p2~hash-r4
+    ApkVersion apk_parse(std::string_view text)
+    {
+        ApkVersion version;
+        std::size_t i = 0;
+        do
+        {
+            if (at(text, i) == '.')
+                i++;
+            version.numbers.push_back(take_number(text, i));
+        } while (at(text, i) == '.' && is_digit(at(text, i + 1)));
+
+        if (is_alpha(at(text, i)))
+            version.letter = text[i++];
+
+        while (at(text, i) == '_')
+        {
+            auto start = ++i;
+            while (is_alpha(at(text, i)))
+                i++;
+            auto rank = apk_suffix_rank(text.substr(start, i - start));
+            version.suffixes.emplace_back(rank, take_number(text, i));
+        }
+
+        if (auto revision = text.find("-r", i); revision != std::string_view::npos)
+        {
+            i = revision + 2;
+            version.revision = take_number(text, i);
+        }
+        return version;
+    }
+
+    template <typename T>
+    int three_way(const T& a, const T& b)
+    {
+        return a < b ? -1 : b < a ? 1 : 0;
+    }
+
+    // A name and version, pointing into the database they were read from.
+    struct Package
+    {
+        std::string_view name;
+        std::string_view version;
+    };
+
+    // Pins and a default release change which version apt picks in ways
+    // only apt itself should work out.
+    bool apt_pinned()
+    {
+        std::error_code ec;
+        if (fs::exists("/etc/apt/preferences", ec))
+            return true;
+        // apt reads files with no extension or .pref, and skips the rest.
+        for (auto& entry : fs::directory_iterator{"/etc/apt/preferences.d", ec})
+        {
+            auto filename = entry.path().filename().string();
+            if (!starts_with(filename, ".") && (filename.find('.') == std::string::npos || ends_with(filename, ".pref")))
+                return true;
+        }
+
+        std::vector<fs::path> configs{"/etc/apt/apt.conf"};
+        for (auto& entry : fs::directory_iterator{"/etc/apt/apt.conf.d", ec})
+            configs.push_back(entry.path());
+        for (auto& config : configs)
+        {
+            Mapped file{config};
+            if (file.text().find("Default-Release") != std::string_view::npos)
+                return true;
+        }
+        return false;
+    }
+
+    // The priority apt gives a release's packages when nothing is pinned.
+    // NotAutomatic suites (experimental, backports) only get 1, or 100 with
+    // ButAutomaticUpgrades, so their versions don't replace one from a
+    // normal suite.
+    int apt_release_priority(const fs::path& path)
+    {
+        Mapped release{path};
+        bool not_automatic = false, but_automatic_upgrades = false;
+        // InRelease is clearsigned, the armour lines have no colon and are
+        // passed over.
+        paragraphs(release.text(), [&](std::string_view key, std::string_view value) {
+            if (key == "NotAutomatic")
+                not_automatic = value == "yes";
+            else if (key == "ButAutomaticUpgrades")
+                but_automatic_upgrades = value == "yes";
+        }, [] {});
+
+        if (!not_automatic)
+            return 500;
+        return but_automatic_upgrades ? 100 : 1;
+    }
+
+    std::optional<std::vector<Bakaneko::Update>> read_apt()
+    {
+        if (apt_pinned())
+            return std::nullopt;
+
+        Mapped status{"/var/lib/dpkg/status"};
+
+        // "name:arch" of every installed package, and its version.
+        std::unordered_map<std::string, std::string_view> installed;
+        {
+            std::string_view package, architecture, version;
+            bool is_installed = false;
+            paragraphs(status.text(), [&](std::string_view key, std::string_view value) {
+                if (key == "Package")
+                    package = value;
+                else if (key == "Architecture")
+                    architecture = value;
+                else if (key == "Version")
+                    version = value;
+                else if (key == "Status")
+                    is_installed = ends_with(value, " installed");
+            }, [&] {
+                if (is_installed && !package.empty() && !version.empty())
+                    installed.emplace(std::string{package} + ':' + std::string{architecture}, version);
+                package = architecture = version = {};
+                is_installed = false;
+            });
+        }
+
+        // Each list is named after the release it came from, e.g.
+        // host_debian_dists_bookworm-backports_main_binary-amd64_Packages
+        // next to host_debian_dists_bookworm-backports_InRelease.
+        std::error_code ec;
+        std::vector<fs::path> lists;
+        std::map<std::string, int> releases;
+        for (auto& entry : fs::directory_iterator{"/var/lib/apt/lists", ec})
+        {
+            auto filename = entry.path().filename().string();
+            if (ends_with(filename, "_InRelease") || ends_with(filename, "_Release"))
+            {
+                auto prefix = filename.substr(0, filename.rfind('_') + 1);
+                auto priority = apt_release_priority(entry.path());
+                // Both may be there, InRelease is the one apt prefers.
+                if (ends_with(filename, "_InRelease") || releases.find(prefix) == releases.end())
+                    releases.insert_or_assign(std::move(prefix), priority);
+            }
+            else if (ends_with(filename, "_Packages") || ends_with(filename, "_Packages.gz"))
+            {
+                lists.push_back(entry.path());
+            }
+            // Lists apt was told to keep compressed some other way.
+            else if (filename.find("_Packages.") != std::string::npos)
+            {
+                return std::nullopt;
+            }
+        }
+
+        // apt's candidate for each installed package: the version with the
+        // highest priority, the newer one on a tie. The installed version
+        // has at least 100, more when a list still offers it.
+        struct Candidate
+        {
+            int priority = 0;
+            std::string version;
+            int installed_priority = 100;
+        };
+        std::unordered_map<std::string_view, Candidate> candidates;
+        std::string key;
+        for (auto& path : lists)
+        {
+            auto filename = path.filename().string();
+            // The longest release prefix the list's name starts with, a list
+            // without one (a trusted local directory, say) counts as normal.
+            auto priority = 500;
+            std::size_t matched = 0;
+            for (auto& [prefix, release] : releases)
+            {
+                if (prefix.size() > matched && starts_with(filename, prefix))
+                {
+                    matched = prefix.size();
+                    priority = release;
+                }
+            }
+
+            Index list{path};
+            if (!list.ok())
+                return std::nullopt;
+
+            std::string_view package, architecture, version;
+            paragraphs(list.text(), [&](std::string_view key, std::string_view value) {
+                if (key == "Package")
+                    package = value;
+                else if (key == "Architecture")
+                    architecture = value;
+                else if (key == "Version")
+                    version = value;
+            }, [&] {
+                key.assign(package);
+                key += ':';
+                key.append(architecture);
+                if (auto current = installed.find(key); current != installed.end())
+                {
+                    auto& candidate = candidates[current->first];
+                    if (Packages::compare_deb(version, current->second) == 0)
+                        candidate.installed_priority = std::max(candidate.installed_priority, priority);
+                    else if (priority > candidate.priority || (priority == candidate.priority && Packages::compare_deb(version, candidate.version) > 0))
+                    {
+                        candidate.priority = priority;
+                        candidate.version = version;
+                    }
+                }
+                package = architecture = version = {};
+            });
+        }
+
+        std::vector<Bakaneko::Update> updates;
+        for (auto& [id, candidate] : candidates)
+        {
+            auto& current = installed.find(std::string{id})->second;
+            // The installed version wins unless something outranks it, and
+            // apt never picks an older one without a pin above 1000.
+            if (candidate.version.empty() || candidate.priority < candidate.installed_priority || Packages::compare_deb(candidate.version, current) <= 0)
+                continue;
+
+            Bakaneko::Update update;
+            update.name = id.substr(0, id.rfind(':'));
+            update.old_version = current;
+            update.new_version = candidate.version;
+            updates.push_back(std::move(update));
+        }
+        std::sort(updates.begin(), updates.end(), [](auto& a, auto& b) { return a.name < b.name; });
+        return updates;
+    }
+
+    // %NAME% and %VERSION% out of a pacman desc file.
+    Package alpm_desc(std::string_view text)
+    {
+        Package package;
+        while (!text.empty())
+        {
+            auto line = next_line(text);
+            if (line == "%NAME%")
+                package.name = next_line(text);
+            else if (line == "%VERSION%")
+                package.version = next_line(text);
+        }
+        return package;
+    }
+
+    // Sync databases in the order pacman.conf lists their repositories, the
+    // order pacman picks a package from.
+    std::vector<std::string> pacman_repositories()
+    {
+        std::vector<std::string> repositories;
+        std::ifstream conf{"/etc/pacman.conf"};
+        for (std::string line; std::getline(conf, line);)
+        {
+            auto start = line.find_first_not_of(" \t");
+            if (start == std::string::npos || line[start] != '[')
+                continue;
+            auto end = line.find(']', start);
+            if (end == std::string::npos)
+                continue;
+            auto name = line.substr(start + 1, end - start - 1);
+            if (name != "options")
+                repositories.push_back(std::move(name));
+        }
+        return repositories;
+    }
+
+    std::optional<std::vector<Bakaneko::Update>> read_pacman()
+    {
+        std::map<std::string, std::string, std::less<>> local;
+        std::error_code ec;
+        for (auto& entry : fs::directory_iterator{"/var/lib/pacman/local", ec})
+        {
+            Mapped desc{entry.path() / "desc"};
+            auto package = alpm_desc(desc.text());
+            if (!package.name.empty())
+                local.emplace(package.name, package.version);
+        }
+
+        std::map<std::string_view, std::string, std::less<>> sync;
+        for (auto& repository : pacman_repositories())
+        {
+            Index database{fs::path{"/var/lib/pacman/sync"} / (repository + ".db")};
+            if (!database.ok())
+                return std::nullopt;
+
+            tar(database.text(), [&](std::string_view name, std::string_view contents) {
+                if (!ends_with(name, "/desc"))
+                    return;
+                auto package = alpm_desc(contents);
+                // An earlier repository's version wins.
+                if (auto installed = local.find(package.name); installed != local.end())
+                    sync.try_emplace(installed->first, package.version);
+            });
+        }
+
+        std::vector<Bakaneko::Update> updates;
+        for (auto& [name, version] : local)
+        {
+            auto candidate = sync.find(name);
+            if (candidate == sync.end() || Packages::compare_alpm(candidate->second, version) <= 0)
+                continue;
+
+            Bakaneko::Update update;
+            update.name = name;
+            update.old_version = version;
+            update.new_version = candidate->second;
+            updates.push_back(std::move(update));
+        }
+        return updates;
+    }
+
+    std::optional<std::vector<Bakaneko::Update>> read_apk()
+    {
+        Mapped database{"/lib/apk/db/installed"};
+
+        std::map<std::string_view, std::string_view> installed;
+        {
+            Package package;
+            paragraphs(database.text(), [&](std::string_view key, std::string_view value) {
+                if (key == "P")
+                    package.name = value;
+                else if (key == "V")
+                    package.version = value;
+            }, [&] {
+                if (!package.name.empty())
+                    installed.emplace(package.name, package.version);
+                package = {};
+            });
+        }
+
+        std::map<std::string_view, std::string> candidates;
+        bool indexed = false;
+        std::error_code ec;
+        for (auto& entry : fs::directory_iterator{"/var/cache/apk", ec})
+        {
+            auto filename = entry.path().filename().string();
+            if (!starts_with(filename, "APKINDEX.") || !ends_with(filename, ".tar.gz"))
+                continue;
+
+            // A signature and the index as separate gzip members.
+            Index archive{entry.path()};
+            if (!archive.ok())
+                return std::nullopt;
+            indexed = true;
+
+            tar(archive.text(), [&](std::string_view name, std::string_view contents) {
+                if (name != "APKINDEX")
+                    return;
+
+                Package package;
+                paragraphs(contents, [&](std::string_view key, std::string_view value) {
+                    if (key == "P")
+                        package.name = value;
+                    else if (key == "V")
+                        package.version = value;
+                }, [&] {
+                    if (auto current = installed.find(package.name); current != installed.end())
+                    {
+                        auto& candidate = candidates[current->first];
+                        if (candidate.empty() || Packages::compare_apk(package.version, candidate) > 0)
+                            candidate = package.version;
+                    }
+                    package = {};
+                });
+            });
+        }
+        // Indexes only live in the cache when one is configured.
+        if (!indexed)
+            return std::nullopt;
+
+        std::vector<Bakaneko::Update> updates;
+        for (auto& [name, candidate] : candidates)
+        {
+            auto current = installed[name];
+            if (Packages::compare_apk(candidate, current) <= 0)
+                continue;
+
+            Bakaneko::Update update;
+            update.name = name;
+            update.old_version = current;
+            update.new_version = candidate;
+            updates.push_back(std::move(update));
+        }
+        return updates;
+    }
+
+    // Splits off the next space separated word.
+    std::string_view next_word(std::string_view& text)
+    {
+        auto start = std::min(text.find_first_not_of(' '), text.size());
+        text.remove_prefix(start);
+        auto word = text.substr(0, text.find(' '));
+        text.remove_prefix(word.size());
+        return word;
+    }
+
+    // name old -> new
+    bool pacman_decode(Bakaneko::Update& update, std::string_view line)
+    {
+        auto name = next_word(line);
+        auto old_version = next_word(line);
+        auto arrow = next_word(line);
+        auto new_version = next_word(line);
+        if (arrow != "->" || new_version.empty())
+            return false;
+
+        update.name = name;
+        update.old_version = old_version;
+        update.new_version = new_version;
+        return true;
+    }
+
+    // name/suite new arch [upgradable from: old]
+    bool apt_decode(Bakaneko::Update& update, std::string_view line)
+    {
+        auto name = next_word(line);
+        auto new_version = next_word(line);
+        auto from = line.find("from: ");
+        if (name.find('/') == std::string_view::npos || from == std::string_view::npos || !ends_with(line, "]"))
+            return false;
+
+        update.name = name.substr(0, name.find('/'));
+        update.old_version = line.substr(from + 6, line.size() - from - 7);
+        update.new_version = new_version;
+        return true;
+    }
+
+    // name-old-rN < new
+    bool apk_decode(Bakaneko::Update& update, std::string_view line)
+    {
+        auto package = next_word(line);
+        auto comparison = next_word(line);
+        auto new_version = next_word(line);
+        auto revision = package.rfind("-r");
+        if (comparison != "<" || new_version.empty() || revision == std::string_view::npos || revision == 0)
+            return false;
+
+        auto version = package.rfind('-', revision - 1);
+        if (version == std::string_view::npos)
+            return false;
+
+        update.name = package.substr(0, version);
+        update.old_version = package.substr(version + 1);
+        update.new_version = new_version;
+        return true;
+    }
+
+    const Packages::Manager pacman{"pacman", &read_pacman, "pacman -Qu"              , &pacman_decode};
+    const Packages::Manager apt   {"apt"   , &read_apt   , "apt list --upgradable"   , &apt_decode   };
+    const Packages::Manager apk   {"apk"   , &read_apk   , "apk version -v -l '<'"   , &apk_decode   };
+}
+
+const std::vector<const Packages::Manager*>& Packages::detected()
+{
+    static const auto managers = [] {
+        std::vector<const Manager*> found;
+        std::error_code ec;
+        if (fs::exists("/var/lib/pacman/local", ec))
+            found.push_back(&pacman);
+        if (fs::exists("/var/lib/dpkg/status", ec))
+            found.push_back(&apt);
+        if (fs::exists("/lib/apk/db/installed", ec))
+            found.push_back(&apk);
+
+        for (auto manager : found)
+            spdlog::info("Reading updates from {}", manager->name);
+        return found;
+    }();
+    return managers;
+}
+
+int Packages::compare_deb(std::string_view a, std::string_view b)
+{
+    struct Version
+    {
+        std::uint64_t epoch = 0;
+        std::string_view upstream;
+        std::string_view revision;
+    };
+    auto split = [](std::string_view text) {
+        Version version;
+        if (auto colon = text.find(':'); colon != std::string_view::npos)
+        {
+            std::size_t i = 0;
+            version.epoch = take_number(text, i);
+            text.remove_prefix(colon + 1);
+        }
+        auto dash = text.rfind('-');
+        version.upstream = text.substr(0, dash);
+        if (dash != std::string_view::npos)
+            version.revision = text.substr(dash + 1);
+        return version;
+    };
+
+    auto one = split(a), two = split(b);
+    if (auto result = three_way(one.epoch, two.epoch); result != 0)
+        return result;
+    if (auto result = deb_compare(one.upstream, two.upstream); result != 0)
+        return result;
+    return deb_compare(one.revision, two.revision);
+}
+
+int Packages::compare_alpm(std::string_view a, std::string_view b)
+{
+    struct Version
+    {
+        std::string_view epoch = "0";
+        std::string_view version;
+        std::string_view release;
+    };
+    auto split = [](std::string_view text) {
+        Version version;
+        auto start = std::find_if_not(text.begin(), text.end(), is_digit) - text.begin();
+        if (at(text, start) == ':')
+        {
+            version.epoch = start ? text.substr(0, start) : "0";
+            text.remove_prefix(start + 1);
+        }
+        auto dash = text.rfind('-');
+        version.version = text.substr(0, dash);
+        if (dash != std::string_view::npos)
+            version.release = text.substr(dash + 1);
+        return version;
+    };
+
+    auto one = split(a), two = split(b);
+    if (auto result = rpmvercmp(one.epoch, two.epoch); result != 0)
+        return result;
+    if (auto result = rpmvercmp(one.version, two.version); result != 0)
+        return result;
+    if (!one.release.empty() && !two.release.empty())
+        return rpmvercmp(one.release, two.release);
+    return 0;
+}
+
+int Packages::compare_apk(std::string_view a, std::string_view b)
+{
+    auto one = apk_parse(a), two = apk_parse(b);
+
+    for (std::size_t i = 0; i < std::min(one.numbers.size(), two.numbers.size()); i++)
+    {
+        if (auto result = three_way(one.numbers[i], two.numbers[i]); result != 0)
+            return result;
+    }
+    if (auto result = three_way(one.numbers.size(), two.numbers.size()); result != 0)
+        return result;
+    if (auto result = three_way(one.letter, two.letter); result != 0)
+        return result;
+
+    // A missing suffix ranks as the bare version, between the pre-releases
+    // and the patch levels.
+    for (std::size_t i = 0; i < std::max(one.suffixes.size(), two.suffixes.size()); i++)
+    {
+        auto first  = i < one.suffixes.size() ? one.suffixes[i] : std::pair<int, std::uint64_t>{};
+        auto second = i < two.suffixes.size() ? two.suffixes[i] : std::pair<int, std::uint64_t>{};
+        if (auto result = three_way(first, second); result != 0)
+            return result;
+    }
+    return three_way(one.revision, two.revision);
+}
@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <vector>
+#include <optional>
+#include <string_view>
+
+#include "updates.hpp"
+
+// Pending upgrades read straight from the package managers' databases, the
+// same lists `apt list --upgradable`, `pacman -Qu` and `apk version -l '<'`
+// print, without running them. Files are memory mapped and parsed in place.
+namespace Packages
+{
+    struct Manager
+    {
+        std::string_view name;
+
+        // Reads the pending upgrades from the database. Returns nullopt
+        // when it can't make sense of the files, e.g. an index compressed
+        // with something other than gzip or apt pins it would have to
+        // apply, and command should be run instead.
+        std::optional<std::vector<Bakaneko::Update>> (*read)();
+
+        // Fallback, decode() is called for each line it prints.
+        std::string_view command;
+        bool (*decode)(Bakaneko::Update& update, std::string_view line);
+    };
+
+    // Managers whose database exists on this host, looked for once.
+    const std::vector<const Manager*>& detected();
+
+    // Version ordering of each manager, <0, 0 or >0 like strcmp().
+    int compare_deb (std::string_view a, std::string_view b);
+    int compare_alpm(std::string_view a, std::string_view b);
+    int compare_apk (std::string_view a, std::string_view b);
+}
@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "probe.hpp"
+#include "config.hpp"
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <condition_variable>
+
+#include <ljh/system_info.hpp>
+
+#include <spdlog/spdlog.h>
+
+#if defined(LJH_TARGET_Linux)
+#include <sys/statvfs.h>
+#endif
+
+namespace
+{
+    struct Job
+    {
+        std::string mountpoint;
+        Probe::Usage result;
+        bool running = false;
+        bool done    = false;
+        // Still running past a caller's deadline, its worker no longer
+        // counts towards the pool size.
+        bool lost    = false;
+    };
+
+    class Prober
+    {
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable finished;
+
+        std::deque<std::shared_ptr<Job>> queue;
+        // Every job queued or running, by mountpoint.
+        std::map<std::string, std::shared_ptr<Job>, std::less<>> in_flight;
+
+        std::size_t workers = 0;
+        std::size_t idle    = 0;
+        std::size_t lost    = 0;
+
+        static Probe::Usage measure(const std::string& mountpoint)
+        {
+            Probe::Usage usage;
+#if defined(LJH_TARGET_Linux)
+            struct statvfs info;
+            if (statvfs(mountpoint.c_str(), &info) == 0)
+            {
+                usage.available = true;
+                usage.size = static_cast<uint64_t>(info.f_blocks) * info.f_frsize;
+                usage.used = static_cast<uint64_t>(info.f_blocks - info.f_bfree) * info.f_frsize;
+            }
+#endif
+            return usage;
+        }
+
+        void work()
+        {
+            std::unique_lock guard{lock};
+            for (;;)
+            {
+                idle++;
+                wake.wait(guard, [this] { return !queue.empty(); });
+                idle--;
+
+                auto job = std::move(queue.front());
+                queue.pop_front();
+                job->running = true;
+
+                guard.unlock();
+                auto result = measure(job->mountpoint);
+                guard.lock();
+
+                job->result = result;
+                job->done = true;
+                in_flight.erase(job->mountpoint);
+                finished.notify_all();
+
+                if (job->lost)
+                {
+                    spdlog::info("{} answered again", job->mountpoint);
+                    lost--;
+                    // Its replacement is already running.
+                    if (workers - lost > std::max<std::size_t>(config.drives.probe_threads, 1))
+                    {
+                        workers--;
+                        return;
+                    }
+                }
+            }
+        }
+
+    public:
+        std::vector<Probe::Usage> usage(const std::vector<std::string>& mountpoints)
+        {
+            std::unique_lock guard{lock};
+
+            std::vector<std::shared_ptr<Job>> jobs;
+            jobs.reserve(mountpoints.size());
+            for (auto& mountpoint : mountpoints)
+            {
+                auto& job = in_flight[mountpoint];
+                if (!job)
+                {
+                    job = std::make_shared<Job>();
+                    job->mountpoint = mountpoint;
+                    queue.push_back(job);
+                }
+                jobs.push_back(job);
+            }
+
+            auto threads = std::max<std::size_t>(config.drives.probe_threads, 1);
+            for (auto queued = queue.size(); idle < queued && workers - lost < threads; queued--)
+            {
+                std::thread{&Prober::work, this}.detach();
+                workers++;
+            }
+            if (!queue.empty())
+                wake.notify_all();
+
+            finished.wait_for(guard, config.drives.probe_timeout, [&jobs] {
+                return std::all_of(jobs.begin(), jobs.end(), [](auto& job) { return job->done; });
+            });
+
+            std::vector<Probe::Usage> results;
+            results.reserve(jobs.size());
+            for (auto& job : jobs)
+            {
+                if (!job->done && job->running && !job->lost)
+                {
+                    spdlog::warn("{} did not answer within {}ms, reporting it as unavailable", job->mountpoint, config.drives.probe_timeout.count());
+                    job->lost = true;
+                    lost++;
+                }
+                results.push_back(job->done ? job->result : Probe::Usage{});
+            }
+            return results;
+        }
+    };
+
+    // Never destroyed, detached workers may still be blocked in it at exit.
+    Prober& prober()
+    {
+        static auto instance = new Prober;
+        return *instance;
+    }
+}
+
+std::vector<Probe::Usage> Probe::usage(const std::vector<std::string>& mountpoints)
+{
+    if (mountpoints.empty())
+        return {};
+    return prober().usage(mountpoints);
+}
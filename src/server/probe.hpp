@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Asks mounted filesystems how full they are without letting a hung one
+// (a stale NFS or CIFS mount, a dead USB disk) block the caller. Probes run
+// concurrently on their own threads, and whatever hasn't answered by the
+// deadline is reported as unavailable.
+//
+// A probe stuck in the kernel can't be cancelled, so its thread is written
+// off and replaced. The mountpoint isn't probed again until that probe
+// returns, later callers just wait on the same one, so a hung mount costs
+// one thread no matter how often it is asked about.
+namespace Probe
+{
+    struct Usage
+    {
+        bool available = false;
+        uint64_t size = 0;
+        uint64_t used = 0;
+    };
+
+    // One result per mountpoint, in the same order.
+    std::vector<Usage> usage(const std::vector<std::string>& mountpoints);
+}
@@ -0,0 +1,350 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "process.hpp"
+
+#include <ljh/system_info.hpp>
+
+#include <future>
+
+#if defined(LJH_TARGET_Linux)
+#include "config.hpp"
+#include "metrics.hpp"
+
+#include <set>
+#include <map>
+#include <array>
+#include <mutex>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <csignal>
+
+#include <spawn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include <spdlog/spdlog.h>
+
+extern char** environ;
+
+namespace
+{
+    using strand_type = asio::strand<asio::io_context::executor_type>;
+
+    struct Child
+    {
+        std::vector<std::string> argv;
+        Process::Handler done;
+        Process::Options options;
+        Process::Result result;
+
+        pid_t pid = -1;
+        bool exited = false;
+        Metrics::clock::time_point started;
+
+        struct Stream
+        {
+            asio::posix::stream_descriptor descriptor;
+            std::string& into;
+            std::array<char, 4096> chunk;
+        };
+        Stream out;
+        Stream err;
+        int open_streams = 0;
+        asio::steady_timer deadline;
+
+        Child(strand_type& strand, std::vector<std::string> argv, Process::Handler done, Process::Options options)
+            : argv(std::move(argv)), done(std::move(done)), options(options),
+              out{asio::posix::stream_descriptor{strand}, result.out, {}},
+              err{asio::posix::stream_descriptor{strand}, result.err, {}},
+              deadline(strand)
+        {
+            // Most commands print well under this, so there is no growing
+            // on the way.
+            result.out.reserve(64 * 1024);
+            result.err.reserve(4 * 1024);
+        }
+    };
+
+    // Everything runs on one strand.
+    class Runner : public std::enable_shared_from_this<Runner>
+    {
+        strand_type strand;
+        asio::signal_set signals;
+        std::deque<std::shared_ptr<Child>> waiting;
+        std::map<pid_t, std::shared_ptr<Child>> running;
+
+        // Children whose handler hasn't been called yet, wherever they are,
+        // so stop() can fail the ones still queued on the strand too.
+        std::mutex lock;
+        std::set<std::shared_ptr<Child>> unfinished;
+        bool stopped = false;
+
+        void reap()
+        {
+            signals.async_wait(asio::bind_executor(strand, [this, self = shared_from_this()](boost::system::error_code ec, int) {
+                if (ec)
+                    return;
+
+                // Signals merge, one SIGCHLD can stand for several children.
+                // Only our own are waited for.
+                std::vector<std::shared_ptr<Child>> exited;
+                for (auto& [pid, child] : running)
+                {
+                    int status;
+                    if (child->exited || waitpid(pid, &status, WNOHANG) != pid)
+                        continue;
+                    child->exited = true;
+                    child->result.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+                    exited.push_back(child);
+                }
+                for (auto& child : exited)
+                    finish(child);
+                reap();
+            }));
+        }
+
+        void launch()
+        {
+            while (!waiting.empty() && running.size() < config.processes.max_running)
+            {
+                auto child = std::move(waiting.front());
+                waiting.pop_front();
+                spawn(child);
+            }
+        }
+
+        void spawn(const std::shared_ptr<Child>& child)
+        {
+            int out[2], err[2];
+            if (pipe2(out, O_CLOEXEC) < 0)
+                return fail(child, errno);
+            if (pipe2(err, O_CLOEXEC) < 0)
+            {
+                auto error = errno;
+                close(out[0]);
+                close(out[1]);
+                return fail(child, error);
+            }
+
+            posix_spawn_file_actions_t actions;
+            posix_spawn_file_actions_init(&actions);
+            posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+            posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+            posix_spawn_file_actions_adddup2(&actions, err[1], STDERR_FILENO);
+
+            // Its own process group, so a timeout kills whatever it started
+            // too, with default signal handling and nothing blocked whatever
+            // the server changed.
+            posix_spawnattr_t attributes;
+            posix_spawnattr_init(&attributes);
+            posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+            posix_spawnattr_setpgroup(&attributes, 0);
+            sigset_t signals;
+            sigemptyset(&signals);
+            posix_spawnattr_setsigmask(&attributes, &signals);
+            sigfillset(&signals);
+            posix_spawnattr_setsigdefault(&attributes, &signals);
+
+            std::vector<char*> argv;
+            for (auto& arg : child->argv)
+                argv.push_back(arg.data());
+            argv.push_back(nullptr);
+
+            auto error = posix_spawnp(&child->pid, argv[0], &actions, &attributes, argv.data(), environ);
+            posix_spawnattr_destroy(&attributes);
+            posix_spawn_file_actions_destroy(&actions);
+            close(out[1]);
+            close(err[1]);
+            if (error != 0)
+            {
+                close(out[0]);
+                close(err[0]);
+                return fail(child, error);
+            }
+
+            child->started = Metrics::clock::now();
+            running.emplace(child->pid, child);
+            child->out.descriptor.assign(out[0]);
+            child->err.descriptor.assign(err[0]);
+            child->open_streams = 2;
+            read(child, child->out);
+            read(child, child->err);
+
+            child->deadline.expires_after(child->options.timeout.count() > 0 ? child->options.timeout : config.processes.timeout);
+            child->deadline.async_wait(asio::bind_executor(strand, [this, self = shared_from_this(), child](boost::system::error_code ec) {
+                if (ec)
+                    return;
+                if (!child->exited)
+                {
+                    spdlog::warn("Killing '{}', it ran out of time", child->argv.front());
+                    child->result.timed_out = true;
+                    kill(-child->pid, SIGKILL);
+                }
+                // Something that left the group (a daemon the command
+                // started, say) may still hold the pipes after it exited.
+                boost::system::error_code ignored;
+                child->out.descriptor.close(ignored);
+                child->err.descriptor.close(ignored);
+            }));
+        }
+
+        void read(const std::shared_ptr<Child>& child, Child::Stream& stream)
+        {
+            stream.descriptor.async_read_some(asio::buffer(stream.chunk), asio::bind_executor(strand, [this, self = shared_from_this(), child, &stream](boost::system::error_code ec, std::size_t read_bytes) {
+                auto room = child->options.output_limit - std::min(child->options.output_limit, stream.into.size());
+                stream.into.append(stream.chunk.data(), std::min(read_bytes, room));
+                if (!ec)
+                    return read(child, stream);
+
+                boost::system::error_code ignored;
+                stream.descriptor.close(ignored);
+                child->open_streams--;
+                finish(child);
+            }));
+        }
+
+        void fail(const std::shared_ptr<Child>& child, int error)
+        {
+            spdlog::warn("Couldn't run '{}': {}", child->argv.front(), std::strerror(error));
+            complete(child);
+        }
+
+        // Done once it has exited and both pipes are drained.
+        void finish(const std::shared_ptr<Child>& child)
+        {
+            if (!child->exited || child->open_streams > 0)
+                return;
+            child->deadline.cancel();
+            running.erase(child->pid);
+
+            // Labelled by the program alone, its arguments could be anything.
+            auto& program = child->argv.front();
+            Metrics::ran(Metrics::command(program.substr(program.find_last_of('/') + 1)), Metrics::clock::now() - child->started);
+            complete(child);
+            launch();
+        }
+
+        void complete(const std::shared_ptr<Child>& child)
+        {
+            {
+                std::lock_guard guard{lock};
+                if (unfinished.erase(child) == 0)
+                    return;
+            }
+            child->done(std::move(child->result));
+        }
+
+    public:
+        explicit Runner(asio::io_context& io_context)
+            : strand(io_context.get_executor()), signals(strand, SIGCHLD)
+        {}
+
+        void start()
+        {
+            reap();
+        }
+
+        void run(std::vector<std::string> argv, Process::Handler done, Process::Options options)
+        {
+            if (argv.empty())
+                return done({});
+            auto child = std::make_shared<Child>(strand, std::move(argv), std::move(done), options);
+            bool refused;
+            {
+                std::lock_guard guard{lock};
+                refused = stopped;
+                if (!refused)
+                    unfinished.insert(child);
+            }
+            if (refused)
+                return child->done({});
+
+            asio::post(strand, [this, self = shared_from_this(), child] {
+                waiting.push_back(child);
+                launch();
+            });
+        }
+
+        // Only once the io_context has stopped, nothing runs on the strand
+        // any more.
+        void stop()
+        {
+            std::set<std::shared_ptr<Child>> failed;
+            {
+                std::lock_guard guard{lock};
+                stopped = true;
+                failed = unfinished;
+            }
+
+            boost::system::error_code ignored;
+            signals.cancel(ignored);
+            for (auto& [pid, child] : running)
+            {
+                kill(-pid, SIGKILL);
+                waitpid(pid, nullptr, 0);
+            }
+            running.clear();
+            waiting.clear();
+
+            for (auto& child : failed)
+            {
+                child->result.exit_code = -1;
+                complete(child);
+            }
+        }
+    };
+
+    std::shared_ptr<Runner> runner;
+}
+
+void Process::start(asio::io_context& io_context)
+{
+    runner = std::make_shared<Runner>(io_context);
+    runner->start();
+}
+
+void Process::stop()
+{
+    if (runner)
+        runner->stop();
+    runner.reset();
+}
+
+void Process::run(std::vector<std::string> argv, Handler done, Options options)
+{
+    if (!runner)
+        return done({});
+    runner->run(std::move(argv), std::move(done), options);
+}
+#else
+void Process::start(asio::io_context& io_context)
+{
+}
+
+void Process::stop()
+{
+}
+
+void Process::run(std::vector<std::string> argv, Handler done, Options options)
+{
+    done({});
+}
+#endif
+
+Process::Result Process::run(std::vector<std::string> argv, Options options)
+{
+    std::promise<Result> promise;
+    auto result = promise.get_future();
+    run(std::move(argv), [&promise](Result result) { promise.set_value(std::move(result)); }, options);
+    return result.get();
+}
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <boost/asio/io_context.hpp>
+
+namespace asio = boost::asio;
+
+// Runs commands without a shell or a thread per command: children are
+// started with posix_spawn, their output is read from pipes and their exit
+// seen through SIGCHLD, all on the io_context. Each command gets a
+// deadline, after which its whole process group is killed, and only
+// config.processes.max_running run at once. Linux only.
+namespace Process
+{
+    struct Options
+    {
+        // config.processes.timeout when zero.
+        std::chrono::milliseconds timeout{0};
+        // Output past this much is read and dropped, so a runaway command
+        // can't take the server's memory with it.
+        std::size_t output_limit = 4 * 1024 * 1024;
+    };
+
+    struct Result
+    {
+        // -1 when it couldn't be started or was killed by a signal.
+        int exit_code = -1;
+        bool timed_out = false;
+        std::string out;
+        std::string err;
+    };
+
+    using Handler = std::function<void(Result result)>;
+
+    // Call start() before the io_context runs and stop() once it has
+    // stopped, which fails whatever hasn't finished.
+    void start(asio::io_context& io_context);
+    void stop();
+
+    // Runs argv, looking argv[0] up in PATH, and calls done with the result
+    // on the io_context.
+    void run(std::vector<std::string> argv, Handler done, Options options = {});
+
+    // Same, waiting for the result. Never call it from the io_context's
+    // own threads.
+    Result run(std::vector<std::string> argv, Options options = {});
+}
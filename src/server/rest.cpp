@@ -2,46 +2,82 @@
 // SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
 
 #include "rest.hpp"
+#include "cache.hpp"
+#include "stream.hpp"
+#include "config.hpp"
+#include "access_log.hpp"
+#include "compression.hpp"
+#include "json_writer.hpp"
+#include "msgpack_writer.hpp"
 
 #include <spdlog/spdlog.h>
 
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <map>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
 #include <ljh/function_pointer.hpp>
 #include <ljh/function_traits.hpp>
 
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
-Rest::Server::Connection::Connection(asio::ip::tcp::socket socket_)
+Rest::Server::Connection::Connection(asio::ip::tcp::socket socket_, std::shared_ptr<Sampler> sampler)
 #if BOOST_VERSION < 107000
-    : socket(std::move(socket_)), strand(socket.get_executor()), endpoint(socket.remote_endpoint())
+    : socket(std::move(socket_)), strand(socket.get_executor()), endpoint(socket.remote_endpoint()), idle(socket.get_executor().context()), sampler(std::move(sampler))
 #else
-    : stream(std::move(socket_)), endpoint(stream.socket().remote_endpoint())
+    : stream(std::move(socket_)), endpoint(stream.socket().remote_endpoint()), idle(stream.get_executor()), sampler(std::move(sampler))
 #endif
 {
     // spdlog::get("networking")->info("Got connection from {}:{}", endpoint.address().to_string(), endpoint.port());
+    Metrics::connection_opened();
 }
 
 Rest::Server::Connection::~Connection()
 {
     // spdlog::get("networking")->info("{}:{} disconnected", endpoint.address().to_string(), endpoint.port());
+    for (std::size_t a = 0; a < responses.size(); a++)
+        Metrics::request_dropped();
+    Metrics::connection_closed();
 }
 
 void Rest::Server::Connection::run()
+{
+    asio::dispatch(executor(), [self = shared_from_this()] {
+        self->wait_idle();
+        self->do_read();
+    });
+}
+
+auto Rest::Server::Connection::executor() -> executor_type
 {
 #if BOOST_VERSION < 107000
-    do_read();
+    return strand;
 #else
-    asio::dispatch(stream.get_executor(), beast::bind_front_handler(&Connection::do_read, shared_from_this()));
+    return stream.get_executor();
 #endif
 }
 
 void Rest::Server::Connection::do_read()
 {
+    // Keep reading while earlier responses are still being collected, up to
+    // the pipeline limit. Once the last request this connection will serve
+    // has been read, stop and let the writes drain.
+    if (reading || upgrading || last_id != SIZE_MAX || responses.size() >= std::max<std::size_t>(config.networking.pipeline, 1))
+        return;
+
+    reading = true;
+    req = {};
 #if BOOST_VERSION < 107000
     beast::http::async_read(socket, buffer, req, asio::bind_executor(strand, std::bind(&Connection::on_read, shared_from_this(), std::placeholders::_1, std::placeholders::_2)));
 #else
-    req = {};
-    stream.expires_after(std::chrono::seconds(30));
+    // The idle timer decides when to give up on a quiet connection, a read
+    // must never time out while responses are still owed.
+    stream.expires_never();
     beast::http::async_read(stream, buffer, req, beast::bind_front_handler(&Connection::on_read, shared_from_this()));
 #endif
 }
@@ -49,40 +85,166 @@ void Rest::Server::Connection::do_read()
 void Rest::Server::Connection::on_read(boost::system::error_code ec, std::size_t bytes_transferred)
 {
     boost::ignore_unused(bytes_transferred);
+    reading = false;
 
+    // The client is done sending, answer what it already asked for first.
     if (ec == beast::http::error::end_of_stream)
-        return do_close();
+    {
+        if (responses.empty())
+            return do_close();
+        last_id = first_id + responses.size() - 1;
+        return;
+    }
 
     if (ec)
         return; // fail(ec, "read");
 
-    handler(std::move(req), [this](auto &&msg) {
-        auto sp = std::make_shared<beast::http::message<false, beast::http::string_body>>(std::move(msg));
-        res = sp;
+    idle.cancel();
+
+    if (upgrade())
+        return;
+
+    auto id = first_id + responses.size();
+    responses.push_back({nullptr, req.method(), {}, {}, Metrics::clock::now()});
+    Metrics::request_started();
+
+    auto max_requests = config.networking.max_requests;
+    if (!req.keep_alive() || (max_requests != 0 && ++requests >= max_requests))
+        last_id = id;
+
+    handler(id, std::move(req));
+    do_read();
+}
+
+bool Rest::Server::Connection::upgrade()
+{
+    if (!beast::websocket::is_upgrade(req))
+        return false;
+
+    Query query;
+    if (split_target({req.target().data(), req.target().size()}, query) != "/stream")
+        return false;
+
+    // The socket can't be shared with the responses still owed, stop
+    // reading and upgrade once on_write has sent the last of them.
+    if (!responses.empty())
+    {
+        upgrading = true;
+        return true;
+    }
+
+    do_upgrade();
+    return true;
+}
+
+void Rest::Server::Connection::do_upgrade()
+{
+    upgrading = false;
 #if BOOST_VERSION < 107000
-        beast::http::async_write(socket, *sp, boost::asio::bind_executor(strand, std::bind(&Connection::on_write, shared_from_this(), sp->need_eof(), std::placeholders::_1, std::placeholders::_2)));
+    std::make_shared<Stream>(std::move(socket), sampler)->run(std::move(req));
 #else
-            beast::http::async_write(stream, *sp, beast::bind_front_handler(&Connection::on_write, shared_from_this(), sp->need_eof()));
+    std::make_shared<Stream>(std::move(stream), sampler)->run(std::move(req));
 #endif
-    });
 }
 
-void Rest::Server::Connection::on_write(bool close, boost::system::error_code ec, std::size_t bytes_transferred)
+template <class Message>
+void Rest::Server::Connection::send(std::size_t id, Message &&msg)
 {
-    boost::ignore_unused(bytes_transferred);
+    // Responses for a connection that has already gone away are dropped.
+    if (id < first_id || id - first_id >= responses.size())
+        return;
+
+    auto res = std::make_shared<Response>(std::move(msg));
+    res->keep_alive(id != last_id);
+    responses[id - first_id].response = std::move(res);
+    do_write();
+}
+
+void Rest::Server::Connection::track(std::size_t id, Metrics::Series route, std::string_view path)
+{
+    if (id >= first_id && id - first_id < responses.size())
+    {
+        responses[id - first_id].route = route;
+        responses[id - first_id].path = path;
+    }
+}
+
+void Rest::Server::Connection::do_write()
+{
+    if (writing || responses.empty() || !responses.front().response)
+        return;
+
+    writing = true;
+    auto res = responses.front().response;
+#if BOOST_VERSION < 107000
+    beast::http::async_write(socket, *res, asio::bind_executor(strand, std::bind(&Connection::on_write, shared_from_this(), res, std::placeholders::_1, std::placeholders::_2)));
+#else
+    // Only bounds the write, a pending read keeps its own (never) expiry.
+    stream.expires_after(config.networking.idle_timeout);
+    beast::http::async_write(stream, *res, beast::bind_front_handler(&Connection::on_write, shared_from_this(), res));
+#endif
+}
+
+void Rest::Server::Connection::on_write(std::shared_ptr<Response> res, boost::system::error_code ec, std::size_t bytes_transferred)
+{
+    writing = false;
 
     if (ec)
         return; //fail(ec, "write");
 
-    if (close)
+    auto& slot = responses.front();
+    auto duration = Metrics::clock::now() - slot.started;
+    Metrics::request_finished(slot.route, res->result_int(), bytes_transferred, duration);
+    auto method = beast::http::to_string(slot.method);
+    AccessLog::record({{method.data(), method.size()}, slot.path, res->result_int(), bytes_transferred, duration, endpoint});
+
+    auto last = res->need_eof() || first_id == last_id;
+    responses.pop_front();
+    first_id++;
+
+    if (last)
         return do_close();
 
-    res = nullptr;
+    if (responses.empty() && upgrading)
+        return do_upgrade();
+
+    if (responses.empty())
+        wait_idle();
+
+    do_write();
     do_read();
 }
 
+void Rest::Server::Connection::wait_idle()
+{
+    idle.expires_after(config.networking.idle_timeout);
+#if BOOST_VERSION < 107000
+    idle.async_wait(asio::bind_executor(strand, std::bind(&Connection::on_idle, shared_from_this(), std::placeholders::_1)));
+#else
+    idle.async_wait(beast::bind_front_handler(&Connection::on_idle, shared_from_this()));
+#endif
+}
+
+void Rest::Server::Connection::on_idle(boost::system::error_code ec)
+{
+    // Cancelled (or re-armed) because a request came in.
+    if (ec || !responses.empty() || idle.expiry() > asio::steady_timer::clock_type::now())
+        return;
+
+    boost::system::error_code ignored;
+#if BOOST_VERSION < 107000
+    socket.shutdown(asio::ip::tcp::socket::shutdown_both, ignored);
+    socket.close(ignored);
+#else
+    stream.socket().shutdown(asio::ip::tcp::socket::shutdown_both, ignored);
+    stream.close();
+#endif
+}
+
 void Rest::Server::Connection::do_close()
 {
+    idle.cancel();
+
     boost::system::error_code ec;
 #if BOOST_VERSION < 107000
     socket.shutdown(asio::ip::tcp::socket::shutdown_send, ec);
@@ -92,7 +254,11 @@ void Rest::Server::Connection::do_close()
 }
 
 Rest::Server::Server(asio::io_context &io_service, asio::ip::tcp::endpoint endpoint)
-    : io_service{io_service}, acceptor{io_service}, socket{io_service}
+#if BOOST_VERSION < 107000
+    : io_service{io_service}, acceptor{io_service}, socket{io_service}, sampler{std::make_shared<Sampler>(io_service)}
+#else
+    : io_service{io_service}, acceptor{io_service}, sampler{std::make_shared<Sampler>(io_service)}
+#endif
 {
     acceptor.open(endpoint.protocol());
     acceptor.set_option(asio::socket_base::reuse_address(true));
@@ -108,6 +274,7 @@ void Rest::Server::run()
     do_accept();
 }
 
+#if BOOST_VERSION < 107000
 void Rest::Server::do_accept()
 {
     acceptor.async_accept(socket, std::bind(&Server::on_accept, shared_from_this(), std::placeholders::_1));
@@ -116,176 +283,572 @@ void Rest::Server::do_accept()
 void Rest::Server::on_accept(boost::system::error_code ec)
 {
     if (!ec)
-        std::make_shared<Connection>(std::move(socket))->run();
+        std::make_shared<Connection>(std::move(socket), sampler)->run();
     do_accept();
 }
+#else
+void Rest::Server::do_accept()
+{
+    // Each connection gets its own strand, its reads, writes and timer can
+    // all be in flight at once now.
+    acceptor.async_accept(asio::make_strand(io_service), beast::bind_front_handler(&Server::on_accept, shared_from_this()));
+}
 
-template <class Function, class Body, class Allocator, class Send>
-void Rest::Server::Connection::Run(Function function, beast::http::request<Body, beast::http::basic_fields<Allocator>> &&req, Send &&send)
+void Rest::Server::on_accept(boost::system::error_code ec, asio::ip::tcp::socket peer)
 {
-    using FunctionTraits = ljh::function_traits<Function>;
-    using MessageReply = typename FunctionTraits::return_type::value_type;
+    if (!ec)
+        std::make_shared<Connection>(std::move(peer), sampler)->run();
+    do_accept();
+}
+#endif
 
-    try
+// Strong validator for a serialized body, a 64 bit FNV-1a of its bytes.
+static std::string make_etag(std::string_view body)
+{
+    std::uint64_t hash = 0xcbf29ce484222325;
+    for (auto letter : body)
     {
-        Fields fields;
-        if (auto ele = req.find(beast::http::field::authorization); ele != req.end())
+        hash ^= static_cast<unsigned char>(letter);
+        hash *= 0x100000001b3;
+    }
+
+    char etag[19];
+    std::snprintf(etag, sizeof(etag), "\"%016llx\"", static_cast<unsigned long long>(hash));
+    return etag;
+}
+
+// If-None-Match is a comma separated list of tags (or "*"), and is compared
+// weakly, so a W/ prefix is ignored.
+static bool etag_matches(std::string_view if_none_match, std::string_view etag)
+{
+    while (!if_none_match.empty())
+    {
+        auto end = if_none_match.find(',');
+        auto tag = if_none_match.substr(0, end);
+        if_none_match = end == std::string_view::npos ? std::string_view{} : if_none_match.substr(end + 1);
+
+        while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t')) tag.remove_prefix(1);
+        while (!tag.empty() && (tag.back () == ' ' || tag.back () == '\t')) tag.remove_suffix(1);
+        if (tag.substr(0, 2) == "W/")
+            tag.remove_prefix(2);
+
+        if (tag == "*" || tag == etag)
+            return true;
+    }
+    return false;
+}
+
+enum class Format
+{
+    None, Json, Msgpack,
+};
+
+static Format format_of(std::string_view media_type)
+{
+    if (media_type == "application/json" || media_type == "application/*" || media_type == "*/*")
+        return Format::Json;
+    if (media_type == "application/x-msgpack" || media_type == "application/msgpack" || media_type == "application/vnd.msgpack")
+        return Format::Msgpack;
+    return Format::None;
+}
+
+static std::string_view trim(std::string_view text)
+{
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back () == ' ' || text.back () == '\t')) text.remove_suffix(1);
+    return text;
+}
+
+// The format to answer in. Accept decides when it names something we can
+// write (highest q wins, then whichever came first). Older clients only send
+// Content-Type, so that is used otherwise.
+static Format response_format(const Rest::Request& req)
+{
+    auto format = Format::None;
+    if (auto accept = req.find(beast::http::field::accept); accept != req.end())
+    {
+        std::string_view list{accept->value().data(), accept->value().size()};
+        double best = 0;
+        while (!list.empty())
         {
-            auto field = ele->value();
-            fields.authentication = std::string(field.data(), field.size());
+            auto end = list.find(',');
+            auto entry = list.substr(0, end);
+            list = end == std::string_view::npos ? std::string_view{} : list.substr(end + 1);
+
+            auto parameters = entry.find(';');
+            auto candidate = format_of(trim(entry.substr(0, parameters)));
+            if (candidate == Format::None)
+                continue;
+
+            double q = 1;
+            while (parameters != std::string_view::npos)
+            {
+                auto next = entry.find(';', parameters + 1);
+                auto parameter = trim(entry.substr(parameters + 1, next == std::string_view::npos ? std::string_view::npos : next - parameters - 1));
+                if (parameter.substr(0, 2) == "q=")
+                    q = std::strtod(std::string{parameter.substr(2)}.c_str(), nullptr);
+                parameters = next;
+            }
+
+            if (q > best)
+            {
+                best = q;
+                format = candidate;
+            }
         }
+    }
 
-        auto message_res = [&fields, &req, &function] {
+    if (format == Format::None)
+    {
+        if (auto content_type = req.find(beast::http::field::content_type); content_type != req.end())
+            format = format_of(trim({content_type->value().data(), content_type->value().size()}));
+    }
+    return format;
+}
+
+template <auto function, Executor::Pool pool>
+void Rest::Server::Connection::Run(std::size_t id, std::string_view route, Request &&req, Query &&query)
+{
+    static const auto series = Metrics::route({req.method_string().data(), req.method_string().size()}, route);
+    track(id, series, route);
+
+    asio::post(Executor::get(pool), [self = shared_from_this(), id, route, req = std::move(req), query = std::move(query)]() mutable {
+        auto res = self->Process<function>(route, req, std::move(query));
+        asio::post(self->executor(), [self, id, res = std::move(res)]() mutable {
+            self->send(id, std::move(res));
+        });
+    });
+}
+
+static Fields make_fields(const Rest::Request& req, Rest::Query&& query)
+{
+    Fields fields;
+    fields.query = std::move(query);
+    if (auto ele = req.find(beast::http::field::authorization); ele != req.end())
+    {
+        auto field = ele->value();
+        fields.authentication = std::string(field.data(), field.size());
+    }
+    return fields;
+}
+
+// Only what a collector reads goes into its cache key: the route, the query
+// parameters it looks at and its decoded request. Anything else a client adds
+// to the target can't make new entries.
+static std::string make_key(std::string_view route, const Fields& fields)
+{
+    static const std::map<std::string_view, std::vector<std::string_view>> parameters{
+        {"/network/adapters/history", {"adapter", "seconds"}},
+    };
+
+    std::string key{route.data(), route.size()};
+    key += '\n';
+    if (auto names = parameters.find(route); names != parameters.end())
+    {
+        for (auto name : names->second)
+        {
+            if (auto value = fields.query.find(name); value != fields.query.end())
+            {
+                key.append(name.data(), name.size());
+                key += '=';
+                key += value->second;
+                key += '&';
+            }
+        }
+    }
+    return key;
+}
+
+template <auto function>
+Rest::Response Rest::Server::Connection::Process(std::string_view route, Request &req, Query &&query)
+{
+    using Function = decltype(function);
+    using FunctionTraits = ljh::function_traits<Function>;
+
+    try
+    {
+        auto fields = make_fields(req, std::move(query));
+
+        std::string key;
+        if (req.method() == beast::http::verb::get)
+            key = make_key(route, fields);
+
+        auto message_res = [&] {
             if constexpr (FunctionTraits::argument_count < 2)
             {
-                return function(fields);
+                return Collect<function>(route, key, fields);
             }
             else
             {
                 typename FunctionTraits::template argument_type<1> message_req;
-                if (Body::size(req.body()) != 0)
-                    message_req = json::parse(req.body());
-                return function(fields, message_req);
+                if (req.body().size() != 0)
+                {
+                    std::string_view content_type{req[beast::http::field::content_type].data(), req[beast::http::field::content_type].size()};
+                    if (format_of(trim(content_type)) == Format::Msgpack)
+                        message_req = json::from_msgpack(req.body());
+                    else
+                        message_req = json::parse(req.body());
+                    if (!key.empty())
+                        key += json(message_req).dump();
+                }
+                return Collect<function>(route, key, fields, message_req);
             }
         }();
 
-        if (message_res.has_value())
+        return Reply(req, message_res);
+    }
+    catch (const std::exception &e)
+    {
+        spdlog::error(e.what());
+
+        beast::http::response<beast::http::empty_body> res{beast::http::status::internal_server_error, req.version()};
+        res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
+        res.keep_alive(req.keep_alive());
+        res.prepare_payload();
+        return Response{std::move(res)};
+    }
+}
+
+template <typename T>
+Rest::Response Rest::Server::Connection::Reply(Request &req, const ljh::expected<T, Errors> &message_res)
+{
+    if (message_res.has_value())
+    {
+        if constexpr (!std::is_void_v<T>)
         {
-            if constexpr (!std::is_void_v<MessageReply>)
+            if (auto format = response_format(req); format != Format::None)
             {
-                if (auto content_type = req.find(beast::http::field::content_type); content_type != req.end())
+                beast::http::response<beast::http::string_body> res{beast::http::status::ok, req.version()};
+                if (format == Format::Msgpack)
+                    Msgpack::write(res.body(), *message_res);
+                else
+                    Json::write(res.body(), *message_res);
+
+                auto encoding = Compression::Encoding::Identity;
+                if (config.compression.level > 0 && res.body().size() >= config.compression.threshold)
                 {
-                    if (content_type->value() == "application/json")
+                    if (auto accept_encoding = req.find(beast::http::field::accept_encoding); accept_encoding != req.end())
+                        encoding = Compression::negotiate({accept_encoding->value().data(), accept_encoding->value().size()});
+                }
+
+                // Only GETs are validated, a POST has already acted by the
+                // time its body is made, and its caller needs to see it.
+                std::string etag;
+                if (req.method() == beast::http::verb::get)
+                {
+                    // Each coding is its own representation, so it needs
+                    // its own strong tag.
+                    etag = make_etag(res.body());
+                    if (encoding != Compression::Encoding::Identity)
                     {
-                        beast::http::response<beast::http::string_body> res{beast::http::status::ok, req.version()};
-                        res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
-                        res.set(beast::http::field::content_type, "application/json");
-                        res.body() = json(*message_res).dump();
-                        res.prepare_payload();
-                        return send(std::move(res));
+                        etag.pop_back();
+                        etag += '-';
+                        etag += Compression::name(encoding);
+                        etag += '"';
                     }
-                    //else if (content_type->value() == "text/plain")
-                    //{
-                    //    beast::http::response<beast::http::string_body> res{beast::http::status::ok, req.version()};
-                    //    res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
-                    //    res.set(beast::http::field::content_type, "text/plain");
-                    //    res.body() = message_res->Utf8DebugString();
-                    //    res.prepare_payload();
-                    //    return send(std::move(res));
-                    //}
-                    else
+
+                    if (auto if_none_match = req.find(beast::http::field::if_none_match); if_none_match != req.end())
                     {
-                        std::string_view lpath(content_type->value().data(), content_type->value().size());
-                        std::string_view lclient(req[beast::http::field::user_agent].data(), req[beast::http::field::user_agent].size());
-                        spdlog::get("networking")->warn("Unknown Content-Type '{}' requested from {}:{} ({})", lpath, endpoint.address().to_string(), endpoint.port(), lclient);
+                        if (etag_matches({if_none_match->value().data(), if_none_match->value().size()}, etag))
+                        {
+                            beast::http::response<beast::http::empty_body> res{beast::http::status::not_modified, req.version()};
+                            res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
+                            res.set(beast::http::field::etag, etag);
+                            res.set(beast::http::field::vary, "Accept, Accept-Encoding, Content-Type");
+                            res.keep_alive(req.keep_alive());
+                            return Response{std::move(res)};
+                        }
                     }
                 }
+
+                res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
+                res.set(beast::http::field::content_type, format == Format::Msgpack ? "application/x-msgpack" : "application/json");
+                if (!etag.empty())
+                    res.set(beast::http::field::etag, etag);
+                res.set(beast::http::field::vary, "Accept, Accept-Encoding, Content-Type");
+                if (encoding != Compression::Encoding::Identity)
+                {
+                    auto coding = Compression::name(encoding);
+                    res.set(beast::http::field::content_encoding, beast::string_view{coding.data(), coding.size()});
+                    res.body() = Compression::compress(res.body(), encoding, config.compression.level);
+                }
+                res.prepare_payload();
+                return Response{std::move(res)};
             }
             else
             {
-                beast::http::response<beast::http::string_body> res{beast::http::status::ok, req.version()};
-                res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
-                res.prepare_payload();
-                return send(std::move(res));
+                std::string_view laccept(req[beast::http::field::accept].data(), req[beast::http::field::accept].size());
+                std::string_view lpath(req[beast::http::field::content_type].data(), req[beast::http::field::content_type].size());
+                std::string_view lclient(req[beast::http::field::user_agent].data(), req[beast::http::field::user_agent].size());
+                spdlog::get("networking")->warn("Unknown Accept '{}' / Content-Type '{}' requested from {}:{} ({})", laccept, lpath, endpoint.address().to_string(), endpoint.port(), lclient);
             }
-
-            beast::http::response<beast::http::empty_body> res{beast::http::status::unsupported_media_type, req.version()};
-            res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
-            res.keep_alive(req.keep_alive());
-            res.prepare_payload();
-            return send(std::move(res));
         }
-        else if (message_res.error() == Errors::NotImplemented)
+        else
         {
-            beast::http::response<beast::http::empty_body> res{beast::http::status::not_implemented, req.version()};
+            beast::http::response<beast::http::string_body> res{beast::http::status::ok, req.version()};
             res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
-            res.keep_alive(req.keep_alive());
             res.prepare_payload();
-            return send(std::move(res));
+            return Response{std::move(res)};
         }
-        else if (message_res.error() == Errors::Failed)
+
+        beast::http::response<beast::http::empty_body> res{beast::http::status::unsupported_media_type, req.version()};
+        res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
+        res.keep_alive(req.keep_alive());
+        res.prepare_payload();
+        return Response{std::move(res)};
+    }
+    else if (message_res.error() == Errors::NotImplemented)
+    {
+        beast::http::response<beast::http::empty_body> res{beast::http::status::not_implemented, req.version()};
+        res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
+        res.keep_alive(req.keep_alive());
+        res.prepare_payload();
+        return Response{std::move(res)};
+    }
+    else if (message_res.error() == Errors::Failed)
+    {
+        beast::http::response<beast::http::empty_body> res{beast::http::status::internal_server_error, req.version()};
+        res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
+        res.keep_alive(req.keep_alive());
+        res.prepare_payload();
+        return Response{std::move(res)};
+    }
+    else if (message_res.error() == Errors::NeedsPassword)
+    {
+        std::string_view lpath(req.target().data(), req.target().size());
+        std::string_view lclient(req[beast::http::field::user_agent].data(), req[beast::http::field::user_agent].size());
+        spdlog::get("networking")->warn("Unauthicated Request '{}' requested from {}:{} ({})", lpath, endpoint.address().to_string(), endpoint.port(), lclient);
+
+        beast::http::response<beast::http::empty_body> res{beast::http::status::unauthorized, req.version()};
+        res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
+        res.set(beast::http::field::www_authenticate, "Basic realm=\"User Visible Realm\"");
+        res.keep_alive(req.keep_alive());
+        res.prepare_payload();
+        return Response{std::move(res)};
+    }
+
+    beast::http::response<beast::http::empty_body> res{beast::http::status::internal_server_error, req.version()};
+    res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
+    res.keep_alive(req.keep_alive());
+    res.prepare_payload();
+    return Response{std::move(res)};
+}
+
+template <auto function, auto member>
+static Errors Fill(Bakaneko::Batch& batch, std::string_view route, const Fields& fields)
+{
+    using FunctionTraits = ljh::function_traits<decltype(function)>;
+
+    // Keyed like the single route would be, so both share a cache entry.
+    auto key = make_key(route, fields);
+
+    auto message_res = [&] {
+        if constexpr (FunctionTraits::argument_count < 2)
         {
-            beast::http::response<beast::http::empty_body> res{beast::http::status::internal_server_error, req.version()};
-            res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
-            res.keep_alive(req.keep_alive());
-            res.prepare_payload();
-            return send(std::move(res));
+            return Collect<function>(route, key, fields);
         }
-        else if (message_res.error() == Errors::NeedsPassword)
+        else
         {
-            std::string_view lpath(req.target().data(), req.target().size());
-            std::string_view lclient(req[beast::http::field::user_agent].data(), req[beast::http::field::user_agent].size());
-            spdlog::get("networking")->warn("Unauthicated Request '{}' requested from {}:{} ({})", lpath, endpoint.address().to_string(), endpoint.port(), lclient);
-
-            beast::http::response<beast::http::empty_body> res{beast::http::status::unauthorized, req.version()};
-            res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
-            res.set(beast::http::field::www_authenticate, "Basic realm=\"User Visible Realm\"");
-            res.keep_alive(req.keep_alive());
-            res.prepare_payload();
-            return send(std::move(res));
+            typename FunctionTraits::template argument_type<1> message_req;
+            if (auto type = fields.query.find("type"); type != fields.query.end() && !type->second.empty())
+            {
+                message_req.type = type->second;
+                key += json(message_req).dump();
+            }
+            return Collect<function>(route, key, fields, message_req);
         }
+    }();
+
+    if (!message_res.has_value())
+        return message_res.error();
+    batch.*member = std::move(*message_res);
+    return Errors::None;
+}
+
+void Rest::Server::Connection::Batch(std::size_t id, std::string_view route, Request &&req, Query &&query)
+{
+    using Pool = Executor::Pool;
+    using Status = Bakaneko::Batch::Section::Status;
+
+    static const auto series = Metrics::route("GET", route);
+    track(id, series, route);
+
+    struct Section
+    {
+        std::string_view name;
+        std::string_view route;
+        Pool pool;
+        Errors (*fill)(Bakaneko::Batch&, std::string_view, const Fields&);
+    };
+    static const Section sections[] = {
+        {"system"          , "/system"          , Pool::Fast, &Fill<&Info::System  , &Bakaneko::Batch::system  >},
+        {"service"         , "/service"         , Pool::Fast, &Fill<&Info::Service , &Bakaneko::Batch::service >},
+        {"services"        , "/services"        , Pool::Slow, &Fill<&Info::Services, &Bakaneko::Batch::services>},
+        {"drives"          , "/drives"          , Pool::Slow, &Fill<&Info::Drives  , &Bakaneko::Batch::drives  >},
+        {"updates"         , "/updates"         , Pool::Slow, &Fill<&Info::Updates , &Bakaneko::Batch::updates >},
+        {"network/adapters", "/network/adapters", Pool::Fast, &Fill<&Info::Adapters, &Bakaneko::Batch::adapters>},
+    };
+
+    struct State
+    {
+        Request req;
+        Fields fields;
+        Bakaneko::Batch batch;
+        std::atomic<std::size_t> remaining{0};
+    };
+    auto state = std::make_shared<State>();
+
+    // Unknown sections are answered NotImplemented, like the routes would.
+    std::vector<std::pair<std::size_t, const Section*>> work;
+    std::string_view list;
+    if (auto item = query.find("sections"); item != query.end())
+        list = item->second;
+    while (!list.empty())
+    {
+        auto end = list.find(',');
+        auto name = trim(list.substr(0, end));
+        list = end == std::string_view::npos ? std::string_view{} : list.substr(end + 1);
+
+        auto& names = state->batch.sections;
+        if (name.empty() || std::any_of(names.begin(), names.end(), [name](auto& section) { return section.name == name; }))
+            continue;
+
+        auto section = std::find_if(std::begin(sections), std::end(sections), [name](auto& section) { return section.name == name; });
+        if (section != std::end(sections))
+            work.emplace_back(names.size(), section);
+        names.push_back({std::string{name}, Status::NotImplemented});
     }
-    catch (const std::exception &e)
+
+    state->req = std::move(req);
+    state->fields = make_fields(state->req, std::move(query));
+    state->remaining = work.size();
+
+    auto finish = [self = shared_from_this(), state, id] {
+        auto res = [&] {
+            try
+            {
+                return self->Reply(state->req, ljh::expected<Bakaneko::Batch, Errors>{std::move(state->batch)});
+            }
+            catch (const std::exception &e)
+            {
+                spdlog::error(e.what());
+
+                beast::http::response<beast::http::empty_body> res{beast::http::status::internal_server_error, state->req.version()};
+                res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
+                res.keep_alive(state->req.keep_alive());
+                res.prepare_payload();
+                return Response{std::move(res)};
+            }
+        }();
+        asio::post(self->executor(), [self, id, res = std::move(res)]() mutable {
+            self->send(id, std::move(res));
+        });
+    };
+
+    if (work.empty())
+        return finish();
+
+    for (auto [index, section] : work)
     {
-        spdlog::error(e.what());
+        asio::post(Executor::get(section->pool), [state, index = index, section = section, finish] {
+            auto error = Errors::Failed;
+            try
+            {
+                error = section->fill(state->batch, section->route, state->fields);
+            }
+            catch (const std::exception &e)
+            {
+                spdlog::error(e.what());
+            }
 
-        beast::http::response<beast::http::empty_body> res{beast::http::status::internal_server_error, req.version()};
+            auto& status = state->batch.sections[index].status;
+            switch (error)
+            {
+            case Errors::None          : status = Status::OK            ; break;
+            case Errors::NotImplemented: status = Status::NotImplemented; break;
+            default                    : status = Status::Failed        ; break;
+            }
+
+            if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                finish();
+        });
+    }
+}
+
+void Rest::Server::Connection::Scrape(std::size_t id, std::string_view route, Request &&req, Query &&)
+{
+    static const auto series = Metrics::route("GET", route);
+    track(id, series, route);
+
+    asio::post(Executor::get(Executor::Pool::Fast), [self = shared_from_this(), id, version = req.version(), keep_alive = req.keep_alive()] {
+        beast::http::response<beast::http::string_body> res{beast::http::status::ok, version};
         res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
-        res.keep_alive(req.keep_alive());
+        res.set(beast::http::field::content_type, "text/plain; version=0.0.4");
+        res.set(beast::http::field::cache_control, "no-store");
+        res.keep_alive(keep_alive);
+        res.body() = Metrics::render();
         res.prepare_payload();
-        return send(std::move(res));
-    }
+        asio::post(self->executor(), [self, id, res = std::move(res)]() mutable {
+            self->send(id, std::move(res));
+        });
+    });
+}
+
+const Rest::Router<Rest::Server::Connection::Handler>& Rest::Server::Connection::routes()
+{
+    using verb = beast::http::verb;
+    using Pool = Executor::Pool;
+    static const Router<Handler> routes{
+        {verb::get , "/drives"                  , &Connection::Run<&Info::Drives         , Pool::Slow   >},
+        {verb::get , "/system"                  , &Connection::Run<&Info::System         , Pool::Fast   >},
+        {verb::get , "/updates"                 , &Connection::Run<&Info::Updates        , Pool::Slow   >},
+        {verb::get , "/network/adapters"        , &Connection::Run<&Info::Adapters       , Pool::Fast   >},
+        {verb::get , "/network/adapters/history", &Connection::Run<&Info::AdaptersHistory, Pool::Fast   >},
+        {verb::get , "/service"                 , &Connection::Run<&Info::Service        , Pool::Fast   >},
+        {verb::get , "/services"                , &Connection::Run<&Info::Services       , Pool::Slow   >},
+        {verb::get , "/batch"                   , &Connection::Batch                                     },
+        {verb::get , "/metrics"                 , &Connection::Scrape                                    },
+        {verb::post, "/power/shutdown"          , &Connection::Run<&Control::Shutdown    , Pool::Control>},
+        {verb::post, "/power/reboot"            , &Connection::Run<&Control::Reboot      , Pool::Control>},
+        {verb::post, "/service"                 , &Connection::Run<&Control::Service     , Pool::Control>},
+        {verb::post, "/session"                 , &Connection::Run<&Control::Session     , Pool::Control>},
+    };
+    return routes;
 }
 
-template <class Body, class Allocator, class Send>
-void Rest::Server::Connection::handler(beast::http::request<Body, beast::http::basic_fields<Allocator>> &&req, Send &&send)
+void Rest::Server::Connection::handler(std::size_t id, Request &&req)
 {
-    auto path = req.target();
+    Query query;
+    auto path = split_target({req.target().data(), req.target().size()}, query);
 
-    spdlog::get("networking")->debug("API Requested: ({}) {}", req.method(), std::string{path.data(), path.size()});
+    SPDLOG_LOGGER_DEBUG(spdlog::get("networking"), "API Requested: ({}) {}", req.method(), std::string{path.data(), path.size()});
 
     if (path == "/")
     {
+        static const auto root = Metrics::route("*", "/");
+        track(id, root, "/");
+
         beast::http::response<beast::http::empty_body> res{beast::http::status::found, req.version()};
         res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
         res.keep_alive(req.keep_alive());
         res.prepare_payload();
-        return send(std::move(res));
+        return send(id, std::move(res));
     }
 
-    if (req.method() == beast::http::verb::get)
-    {
-        if (path == "/drives")
-            return Run(&Info::Drives, std::move(req), std::move(send));
-        if (path == "/system")
-            return Run(&Info::System, std::move(req), std::move(send));
-        if (path == "/updates")
-            return Run(&Info::Updates, std::move(req), std::move(send));
-        if (path == "/network/adapters")
-            return Run(&Info::Adapters, std::move(req), std::move(send));
-        if (path == "/service")
-            return Run(&Info::Service, std::move(req), std::move(send));
-        if (path == "/services")
-            return Run(&Info::Services, std::move(req), std::move(send));
-    }
-    if (req.method() == beast::http::verb::post)
-    {
-        if (path == "/power/shutdown")
-            return Run(&Control::Shutdown, std::move(req), std::move(send));
-        if (path == "/power/reboot")
-            return Run(&Control::Reboot, std::move(req), std::move(send));
-        if (path == "/service")
-            return Run(&Control::Service, std::move(req), std::move(send));
-    }
+    if (auto route = routes().find(req.method(), path); route != nullptr)
+        return (this->*route->handler)(id, route->path, std::move(req), std::move(query));
+
+    // Counted together, so made up paths can't add series.
+    static const auto unknown = Metrics::route("*", "unknown");
+    track(id, unknown, "unknown");
 
-    std::string_view lpath(path.data(), path.size());
     std::string_view lclient(req[beast::http::field::user_agent].data(), req[beast::http::field::user_agent].size());
 
-    spdlog::get("networking")->warn("Unknown Path '{}' requested from {}:{} ({})", lpath, endpoint.address().to_string(), endpoint.port(), lclient);
+    spdlog::get("networking")->warn("Unknown Path '{}' requested from {}:{} ({})", path, endpoint.address().to_string(), endpoint.port(), lclient);
 
     beast::http::response<beast::http::empty_body> res{beast::http::status::not_found, req.version()};
     res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
     res.keep_alive(req.keep_alive());
     res.prepare_payload();
-    return send(std::move(res));
+    return send(id, std::move(res));
 };
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <deque>
 #include <memory>
 #include <functional>
 #include <type_traits>
@@ -22,52 +23,129 @@
 
 #include "bakaneko-version.h"
 #include "info.hpp"
+#include "batch.hpp"
+#include "router.hpp"
+#include "metrics.hpp"
+#include "executor.hpp"
 
 namespace asio  = boost::asio ;
 namespace beast = boost::beast;
 
 namespace Rest
 {
+    using Request  = beast::http::request <beast::http::string_body>;
+    using Response = beast::http::response<beast::http::string_body>;
+
+    class Sampler;
+
     class Server : public std::enable_shared_from_this<Server>
     {
         asio::io_service& io_service;
         asio::ip::tcp::acceptor acceptor;
+#if BOOST_VERSION < 107000
         asio::ip::tcp::socket socket;
+#endif
+        std::shared_ptr<Sampler> sampler;
 
     public:
         class Connection : public std::enable_shared_from_this<Connection>
         {
 #if BOOST_VERSION < 107000
+            using executor_type = asio::strand<asio::io_context::executor_type>;
             asio::ip::tcp::socket socket;
-            asio::strand<asio::io_context::executor_type> strand;
+            executor_type strand;
 #else
+            using executor_type = beast::tcp_stream::executor_type;
             beast::tcp_stream stream;
 #endif
             beast::flat_buffer buffer;
-            beast::http::request<beast::http::string_body> req;
-            std::shared_ptr<void> res;
+            Request req;
             asio::ip::tcp::endpoint endpoint;
-
-            template<class Body, class Allocator, class Send>
-            void handler(beast::http::request<Body, beast::http::basic_fields<Allocator>>&& req, Send&& send);
-
-            template<class Function, class Body, class Allocator, class Send>
-            void Run(Function function, beast::http::request<Body, beast::http::basic_fields<Allocator>>&& req, Send&& send);
+            asio::steady_timer idle;
+            std::shared_ptr<Sampler> sampler;
+
+            // Pipelined requests get a slot here in the order they were read.
+            // A slot's response stays empty until its collector finishes, and
+            // only the front slot is ever written, so responses go out in
+            // order.
+            struct Slot
+            {
+                std::shared_ptr<Response> response;
+                beast::http::verb method;
+                std::string_view path;
+                Metrics::Series route;
+                Metrics::clock::time_point started;
+            };
+            std::deque<Slot> responses;
+            std::size_t first_id = 0;
+            std::size_t last_id  = SIZE_MAX;
+            std::size_t requests = 0;
+            bool reading = false;
+            bool writing = false;
+            // A /stream upgrade read behind pipelined requests waits in req
+            // until their responses have been written.
+            bool upgrading = false;
+
+            using Handler = void (Connection::*)(std::size_t id, std::string_view route, Request&& req, Query&& query);
+            static const Router<Handler>& routes();
+
+            void handler(std::size_t id, Request&& req);
+
+            // Which route a request's time and bytes are counted and logged
+            // under. path must be a string literal.
+            void track(std::size_t id, Metrics::Series route, std::string_view path);
+
+            // Hands the connection over to a Rest::Stream when the request
+            // is a WebSocket upgrade for /stream, or holds on to it until
+            // the responses ahead of it are gone.
+            bool upgrade();
+            void do_upgrade();
+
+            // Runs the collector on its pool and posts the response back to
+            // this connection's executor.
+            template<auto function, Executor::Pool pool>
+            void Run(std::size_t id, std::string_view route, Request&& req, Query&& query);
+
+            template<auto function>
+            Response Process(std::string_view route, Request& req, Query&& query);
+
+            template<typename T>
+            Response Reply(Request& req, const ljh::expected<T, Errors>& message_res);
+
+            // Runs the collectors for each requested section concurrently
+            // and answers with one combined Bakaneko::Batch.
+            void Batch(std::size_t id, std::string_view route, Request&& req, Query&& query);
+
+            // Answers with Metrics::render().
+            void Scrape(std::size_t id, std::string_view route, Request&& req, Query&& query);
+
+            executor_type executor();
+
+            template<class Message>
+            void send(std::size_t id, Message&& msg);
+
+            void do_write();
+            void wait_idle();
 
         public:
-            explicit Connection(asio::ip::tcp::socket socket_);
+            Connection(asio::ip::tcp::socket socket_, std::shared_ptr<Sampler> sampler);
             ~Connection();
 
             void run();
             void do_read();
             void on_read(boost::system::error_code ec, std::size_t bytes_transferred);
-            void on_write(bool close, boost::system::error_code ec, std::size_t bytes_transferred);
+            void on_write(std::shared_ptr<Response> res, boost::system::error_code ec, std::size_t bytes_transferred);
+            void on_idle(boost::system::error_code ec);
             void do_close();
         };
 
     private:
         void do_accept();
+#if BOOST_VERSION < 107000
         void on_accept(boost::system::error_code ec);
+#else
+        void on_accept(boost::system::error_code ec, asio::ip::tcp::socket peer);
+#endif
 
     public:
         explicit Server(asio::io_context& io_service, asio::ip::tcp::endpoint endpoint);
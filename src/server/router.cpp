@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "router.hpp"
+
+static std::string url_decode(std::string_view input)
+{
+    auto hex = [](char letter) -> int {
+        if (letter >= '0' && letter <= '9') return letter - '0';
+        if (letter >= 'a' && letter <= 'f') return letter - 'a' + 10;
+        if (letter >= 'A' && letter <= 'F') return letter - 'A' + 10;
+        return -1;
+    };
+
+    std::string output;
+    output.reserve(input.size());
+    for (std::size_t a = 0; a < input.size(); a++)
+    {
+        if (input[a] == '+')
+        {
+            output += ' ';
+        }
+        else if (input[a] == '%' && a + 2 < input.size() && hex(input[a + 1]) >= 0 && hex(input[a + 2]) >= 0)
+        {
+            output += static_cast<char>(hex(input[a + 1]) * 16 + hex(input[a + 2]));
+            a += 2;
+        }
+        else
+        {
+            output += input[a];
+        }
+    }
+    return output;
+}
+
+std::string_view Rest::split_target(std::string_view target, Query& query)
+{
+    auto mark = target.find('?');
+    if (mark == std::string_view::npos)
+        return target;
+
+    auto parameters = target.substr(mark + 1);
+    while (!parameters.empty())
+    {
+        auto end = parameters.find('&');
+        auto parameter = parameters.substr(0, end);
+        parameters = end == std::string_view::npos ? std::string_view{} : parameters.substr(end + 1);
+
+        if (parameter.empty())
+            continue;
+
+        auto equals = parameter.find('=');
+        auto key = url_decode(parameter.substr(0, equals));
+        auto value = equals == std::string_view::npos ? std::string{} : url_decode(parameter.substr(equals + 1));
+        query.insert_or_assign(std::move(key), std::move(value));
+    }
+
+    return target.substr(0, mark);
+}
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <unordered_map>
+#include <initializer_list>
+
+#include <boost/beast/http.hpp>
+
+namespace Rest
+{
+    using Query = std::map<std::string, std::string, std::less<>>;
+
+    // Splits "path?a=1&b=2" into the path and its decoded query parameters.
+    std::string_view split_target(std::string_view target, Query& query);
+
+    // Route table keyed on (verb, path). Built once, then only read from, so
+    // lookups are a single hash of the path no matter how many routes exist.
+    // Paths must outlive the router (they are expected to be string literals).
+    template<typename Handler>
+    class Router
+    {
+        using verb = boost::beast::http::verb;
+
+        struct Key
+        {
+            verb method;
+            std::string_view path;
+
+            bool operator==(const Key& other) const
+            {
+                return method == other.method && path == other.path;
+            }
+        };
+
+        struct KeyHash
+        {
+            std::size_t operator()(const Key& key) const noexcept
+            {
+                return std::hash<std::string_view>{}(key.path) ^ (static_cast<std::size_t>(key.method) << 1);
+            }
+        };
+
+    public:
+        struct Route
+        {
+            verb method;
+            std::string_view path;
+            Handler handler;
+        };
+
+    private:
+        std::unordered_map<Key, Route, KeyHash> routes;
+
+    public:
+
+        Router(std::initializer_list<Route> list)
+        {
+            routes.reserve(list.size());
+            for (auto& route : list)
+                add(route.method, route.path, route.handler);
+        }
+
+        void add(verb method, std::string_view path, Handler handler)
+        {
+            routes.insert_or_assign(Key{method, path}, Route{method, path, std::move(handler)});
+        }
+
+        const Route* find(verb method, std::string_view path) const
+        {
+            if (auto route = routes.find(Key{method, path}); route != routes.end())
+                return &route->second;
+            return nullptr;
+        }
+
+        std::size_t size() const
+        {
+            return routes.size();
+        }
+    };
+}
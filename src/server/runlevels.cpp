@@ -0,0 +1,288 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "runlevels.hpp"
+
+#include <ljh/system_info.hpp>
+
+#if defined(LJH_TARGET_Linux)
+#include "openrc.hpp"
+#include "inotify.hpp"
+#include "executor.hpp"
+
+#include <mutex>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+#include <sys/inotify.h>
+
+#include <boost/asio/post.hpp>
+
+#include <spdlog/spdlog.h>
+
+namespace
+{
+    // Services being added to or deleted from a runlevel, and runlevels
+    // coming and going.
+    constexpr uint32_t runlevel_events = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+    // Scripts and their settings being installed, removed or edited.
+    constexpr uint32_t script_events = runlevel_events | IN_CLOSE_WRITE | IN_ATTRIB;
+
+    std::mutex lock;
+    std::shared_ptr<const Runlevels::Index> published;
+    uint64_t revision = 0;
+    // Scans are numbered when they start, so one that finishes after a
+    // newer one has been published is dropped.
+    uint64_t scans_started = 0;
+    uint64_t scan_published = 0;
+
+    std::map<std::string, std::string> descriptions;
+    // Bumped whenever a description is forgotten, so one that was being
+    // read while its script changed isn't kept.
+    uint64_t descriptions_generation = 0;
+    bool keeping = false;
+
+    // Walks the directories without holding the lock, descriptions are
+    // looked up under it while a listing is being made.
+    void rebuild()
+    {
+        uint64_t scan;
+        {
+            std::lock_guard guard{lock};
+            if (!keeping)
+                return;
+            scan = ++scans_started;
+        }
+
+        auto index = std::make_shared<Runlevels::Index>(Runlevels::scan());
+
+        std::lock_guard guard{lock};
+        if (!keeping || scan < scan_published)
+            return;
+        scan_published = scan;
+        index->revision = ++revision;
+        std::atomic_store(&published, std::shared_ptr<const Runlevels::Index>{std::move(index)});
+    }
+
+    void forget(const std::string& service)
+    {
+        std::lock_guard guard{lock};
+        descriptions_generation++;
+        if (service.empty())
+            descriptions.clear();
+        else
+            descriptions.erase(service);
+    }
+
+    // Owns the inotify instance, everything runs on its strand.
+    class Watcher : public std::enable_shared_from_this<Watcher>
+    {
+        Inotify::Watcher::strand_type strand;
+        std::shared_ptr<Inotify::Watcher> inotify;
+        bool rebuild_queued = false;
+
+        // Watching a directory that is already watched only replaces its
+        // handler, so this runs again for every change to pick up new
+        // runlevels. Ones that go away drop their watch by themselves.
+        void watch_runlevels()
+        {
+            auto changed = [this, self = shared_from_this()](const Inotify::Event&) { queue_rebuild(); };
+            inotify->add(RC_RUNLEVELDIR, runlevel_events, changed);
+
+            std::error_code ec;
+            for (auto& level : std::filesystem::directory_iterator(RC_RUNLEVELDIR, ec))
+            {
+                if (level.is_directory(ec))
+                    inotify->add(level.path(), runlevel_events, changed);
+            }
+        }
+
+        void watch_scripts(const std::string& directory)
+        {
+            inotify->add(directory, script_events, [this, self = shared_from_this()](const Inotify::Event& event) {
+                forget(event.mask & IN_Q_OVERFLOW ? std::string{} : event.name);
+                // Only scripts coming and going change the index, but
+                // telling those apart from edits isn't worth it.
+                queue_rebuild();
+            });
+        }
+
+        // Coalesces a burst of events, like a package manager installing a
+        // dozen scripts, into one rebuild.
+        void queue_rebuild()
+        {
+            if (rebuild_queued)
+                return;
+            rebuild_queued = true;
+            asio::post(strand, [this, self = shared_from_this()] {
+                rebuild_queued = false;
+                if (!inotify || !inotify->is_open())
+                    return;
+                watch_runlevels();
+                rebuild();
+            });
+        }
+
+    public:
+        explicit Watcher(asio::io_context& io_context)
+            : strand(io_context.get_executor())
+        {}
+
+        void start()
+        {
+            inotify = std::make_shared<Inotify::Watcher>(strand);
+            try
+            {
+                inotify->open();
+            }
+            catch (const std::system_error& e)
+            {
+                spdlog::info("Not watching OpenRC runlevels: {}", e.what());
+                return;
+            }
+
+            watch_runlevels();
+            watch_scripts(RC_INITDIR);
+            watch_scripts(RC_CONFDIR);
+
+            {
+                std::lock_guard guard{lock};
+                keeping = true;
+            }
+            rebuild();
+
+            auto index = Runlevels::index();
+            spdlog::info("Watching {} OpenRC services", index->services.size());
+
+            // The first listing would otherwise run every init script one
+            // after the other.
+            asio::post(Executor::get(Executor::Pool::Slow), [index] {
+                for (auto& service : index->services)
+                    Runlevels::description(service);
+            });
+        }
+
+        void stop()
+        {
+            {
+                std::lock_guard guard{lock};
+                keeping = false;
+                descriptions.clear();
+            }
+            if (inotify)
+                inotify->close();
+            inotify.reset();
+            std::atomic_store(&published, std::shared_ptr<const Runlevels::Index>{});
+        }
+    };
+
+    std::shared_ptr<Watcher> watcher;
+}
+
+Runlevels::Index Runlevels::scan()
+{
+    Index index;
+
+    std::error_code ec;
+    for (auto& script : std::filesystem::directory_iterator(RC_INITDIR, ec))
+    {
+        auto id = script.path().filename().string();
+        if (rc_service_exists(id.c_str()))
+            index.services.push_back(std::move(id));
+    }
+    std::sort(index.services.begin(), index.services.end());
+
+    // A service is in a runlevel when there is a link to it in the
+    // runlevel's directory that leads somewhere, the same test
+    // rc_service_in_runlevel makes.
+    for (auto& level : std::filesystem::directory_iterator(RC_RUNLEVELDIR, ec))
+    {
+        if (!level.is_directory(ec))
+            continue;
+        auto name = level.path().filename().string();
+        for (auto& entry : std::filesystem::directory_iterator(level.path(), ec))
+        {
+            if (std::filesystem::exists(entry.path(), ec))
+                index.runlevels[entry.path().filename().string()].insert(name);
+        }
+    }
+
+    return index;
+}
+
+void Runlevels::start(asio::io_context& io_context)
+{
+    // librc isn't there, not an OpenRC machine.
+    if (!rc_service_exists)
+        return;
+    watcher = std::make_shared<Watcher>(io_context);
+    watcher->start();
+}
+
+void Runlevels::stop()
+{
+    if (watcher)
+        watcher->stop();
+    watcher.reset();
+}
+
+std::shared_ptr<const Runlevels::Index> Runlevels::index()
+{
+    return std::atomic_load(&published);
+}
+
+void Runlevels::refresh()
+{
+    rebuild();
+}
+
+std::string Runlevels::description(const std::string& service)
+{
+    uint64_t generation;
+    {
+        std::lock_guard guard{lock};
+        auto found = descriptions.find(service);
+        if (found != descriptions.end())
+            return found->second;
+        generation = descriptions_generation;
+    }
+
+    auto text = rc_service_description(service.c_str(), nullptr);
+    std::string description = text != nullptr ? text : "";
+    free(text);
+
+    std::lock_guard guard{lock};
+    if (keeping && generation == descriptions_generation)
+        descriptions.emplace(service, description);
+    return description;
+}
+#else
+Runlevels::Index Runlevels::scan()
+{
+    return {};
+}
+
+void Runlevels::start(asio::io_context& io_context)
+{
+}
+
+void Runlevels::stop()
+{
+}
+
+std::shared_ptr<const Runlevels::Index> Runlevels::index()
+{
+    return nullptr;
+}
+
+void Runlevels::refresh()
+{
+}
+
+std::string Runlevels::description(const std::string& service)
+{
+    return {};
+}
+#endif
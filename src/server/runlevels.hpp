@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <set>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <boost/asio/io_context.hpp>
+
+namespace asio = boost::asio;
+
+// OpenRC's init scripts and which runlevels they're in. Asking librc takes
+// a stat per service and runlevel, so once started the server reads
+// RC_INITDIR and every runlevel directory once and reads them again only
+// when inotify says they changed. Linux with OpenRC only.
+namespace Runlevels
+{
+    struct Index
+    {
+        // Goes up every time the index is read again.
+        uint64_t revision = 0;
+        // The services in RC_INITDIR, sorted.
+        std::vector<std::string> services;
+        // The runlevels each service is in, ones in none are left out.
+        std::map<std::string, std::set<std::string>> runlevels;
+    };
+
+    // Reads the directories right now.
+    Index scan();
+
+    // Call start() before the io_context runs and stop() once it has
+    // stopped.
+    void start(asio::io_context& io_context);
+    void stop();
+
+    // The index as of the last change, nullptr while it isn't being kept:
+    // OpenRC isn't the service manager or inotify isn't available.
+    std::shared_ptr<const Index> index();
+
+    // Reads the index again straight away instead of when inotify gets
+    // around to it, for callers that just changed a runlevel themselves.
+    void refresh();
+
+    // OpenRC gets a service's description by running its init script. Kept
+    // while the index is, until the script or its conf.d file change.
+    std::string description(const std::string& service);
+}
@@ -8,6 +8,7 @@
 #include <chrono>
 #include <mutex>
 #include <set>
+#include <string_view>
 
 #include <ljh/system_info.hpp>
 #include <ljh/string_utils.hpp>
@@ -17,7 +18,10 @@
 #include <ljh/windows/wmi.hpp>
 #elif defined(LJH_TARGET_Linux)
 #include <ljh/unix/dbus.hpp>
+#include "bus.hpp"
 #include "openrc.hpp"
+#include "runlevels.hpp"
+#include "systemd.hpp"
 #endif
 
 #include <spdlog/spdlog.h>
@@ -41,17 +45,26 @@ service_manager get_service_manager()
             return service_manager::openrc;
         }
 
-        ljh::unix::dbus::connection system_bus(ljh::unix::dbus::bus::SYSTEM);
-        auto interface = system_bus.get(DBUS_SERVICE_DBUS, DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS);
-        auto dbus_services = interface.call("ListNames").run<std::vector<std::string>>();
-        for (auto &service : dbus_services)
+        // ljh's dbus::error isn't a std::exception, nothing further up
+        // would catch it.
+        try
         {
-            if (service == "org.freedesktop.systemd1")
+            auto system_bus = Bus::system();
+            auto interface = system_bus.get(DBUS_SERVICE_DBUS, DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS);
+            auto dbus_services = interface.call("ListNames").run<std::vector<std::string>>();
+            for (auto &service : dbus_services)
             {
-                spdlog::info("Service Manager: systemd");
-                return service_manager::systemd;
+                if (service == "org.freedesktop.systemd1")
+                {
+                    spdlog::info("Service Manager: systemd");
+                    return service_manager::systemd;
+                }
             }
         }
+        catch (const ljh::unix::dbus::error& e)
+        {
+            spdlog::debug("DBus Error: ({}) {}", e.name(), e.message());
+        }
 
         spdlog::warn("Could not determine Service Manager");
         return service_manager::Unknown;
@@ -60,6 +73,51 @@ service_manager get_service_manager()
 }
 #endif
 
+#if defined(LJH_TARGET_Linux)
+namespace
+{
+    // Undoes systemd's \xNN escaping of unit names and descriptions.
+    std::string unescape(std::string text)
+    {
+        for (std::size_t a = 0; a + 3 < text.size(); a++)
+        {
+            if (text[a] == '\\' && text[a + 1] == 'x')
+            {
+                char letter = std::stoull(text.substr(a + 2, 2), nullptr, 16);
+                text.replace(a, 4, 1, letter);
+            }
+        }
+        return text;
+    }
+
+    void describe_unit(Bakaneko::Service &service, const Systemd::Unit &unit)
+    {
+        auto id = unescape(unit.id);
+        service.id = (id);
+        service.display_name = (id);
+        service.description = (unescape(unit.description));
+
+        auto type = id.substr(id.find_last_of('.') + 1);
+        type[0] = std::toupper(type[0]);
+        service.type = (type);
+
+        if (unit.unit_file_state == "enabled" || unit.unit_file_state == "static")
+            service.enabled = (true);
+
+        if (unit.active_state == "inactive")
+            service.state = (Bakaneko::Service::State::Stopped);
+        if (unit.active_state == "failed")
+            service.state = (Bakaneko::Service::State::Stopped);
+        if (unit.active_state == "active")
+            service.state = (Bakaneko::Service::State::Running);
+        if (unit.active_state == "activating")
+            service.state = (Bakaneko::Service::State::Starting);
+        if (unit.active_state == "deactivating")
+            service.state = (Bakaneko::Service::State::Stopping);
+    }
+}
+#endif
+
 template <typename... Ts>
 std::ostream &operator<<(std::ostream &os, std::tuple<Ts...> const &theTuple)
 {
@@ -220,128 +278,24 @@ ljh::expected<Bakaneko::Services, Errors> Info::Services(const Fields &fields, B
     case service_manager::systemd:
         try
         {
-            ljh::unix::dbus::connection system_bus(ljh::unix::dbus::bus::SYSTEM);
-            auto interface = system_bus.get("org.freedesktop.systemd1", "/org/freedesktop/systemd1", "org.freedesktop.systemd1.Manager");
-            auto services = interface.call("ListUnits").run<std::vector<std::tuple<std::string, std::string, std::string, std::string, std::string, ljh::unix::dbus::object_path, uint32_t, std::string, ljh::unix::dbus::object_path>>>();
-            std::set<std::string> files;
-            for (auto &service : services)
+            // Kept current from systemd's signals, only listed here when it
+            // isn't being watched.
+            auto units = Systemd::units();
+            if (!units)
+                units = std::make_shared<const Systemd::Units>(Systemd::list());
+            info.revision = (units->revision);
+
+            std::set<std::string_view> fragments;
+            for (auto &[path, unit] : units->loaded)
             {
-                auto service_interface = system_bus.get("org.freedesktop.systemd1", std::get<8>(service).data(), "org.freedesktop.systemd1.Unit");
-                auto &service_info = info.services.emplace_back();
-
-                auto path = service_interface.get<std::string>("FragmentPath");
-                if (!path.empty())
-                    files.emplace(path);
-
-                auto id = std::get<0>(service);
-                auto description = std::get<1>(service);
-
-                for (int a = 0; a < id.size() - 1; a++)
-                {
-                    if (id[a] == '\\' && id[a + 1] == 'x')
-                    {
-                        auto value = id.substr(a + 2, 2);
-                        char letter = std::stoull(value, nullptr, 16);
-                        id.insert(id.begin() + a, letter);
-                        id.erase(a + 1, 4);
-                    }
-                }
-                for (int a = 0; a < description.size() - 1; a++)
-                {
-                    if (description[a] == '\\' && description[a + 1] == 'x')
-                    {
-                        auto value = description.substr(a + 2, 2);
-                        char letter = std::stoull(value, nullptr, 16);
-                        description.insert(description.begin() + a, letter);
-                        description.erase(a + 1, 4);
-                    }
-                }
-
-                service_info.id = (id);
-                service_info.display_name = (id);
-                service_info.description = (description);
-
-                auto type = id.substr(id.find_last_of('.') + 1);
-                type[0] = std::toupper(type[0]);
-                service_info.type = (type);
-
-                auto enabled_state = service_interface.get<std::string>("UnitFileState");
-                if (enabled_state == "enabled" || enabled_state == "static")
-                    service_info.enabled = (true);
-
-                auto active_state = service_interface.get<std::string>("ActiveState");
-                if (active_state == "inactive")
-                    service_info.state = (Bakaneko::Service::State::Stopped);
-                if (active_state == "failed")
-                    service_info.state = (Bakaneko::Service::State::Stopped);
-                if (active_state == "active")
-                    service_info.state = (Bakaneko::Service::State::Running);
-                if (active_state == "activating")
-                    service_info.state = (Bakaneko::Service::State::Starting);
-                if (active_state == "deactivating")
-                    service_info.state = (Bakaneko::Service::State::Stopping);
+                if (!unit.fragment_path.empty())
+                    fragments.emplace(unit.fragment_path);
+                describe_unit(info.services.emplace_back(), unit);
             }
-            auto unloaded = interface.call("ListUnitFiles").run<std::vector<std::tuple<std::string, std::string>>>();
-            for (auto &service : unloaded)
+            for (auto &[id, unit] : units->files)
             {
-                auto id = std::get<0>(service);
-                if (files.find(id) != files.end())
-                    continue;
-                if (id.find('@') != std::string::npos)
-                    continue;
-
-                id = id.substr(id.find_last_of('/') + 1);
-                auto unit_path = interface.call("LoadUnit").args(id).run<ljh::unix::dbus::object_path>();
-
-                auto service_interface = system_bus.get("org.freedesktop.systemd1", unit_path.data(), "org.freedesktop.systemd1.Unit");
-                auto &service_info = info.services.emplace_back();
-
-                auto description = service_interface.get<std::string>("Description");
-
-                for (int a = 0; a < id.size() - 1; a++)
-                {
-                    if (id[a] == '\\' && id[a + 1] == 'x')
-                    {
-                        auto value = id.substr(a + 2, 2);
-                        char letter = std::stoull(value, nullptr, 16);
-                        id.insert(id.begin() + a, letter);
-                        id.erase(a + 1, 4);
-                    }
-                }
-                for (int a = 0; a < description.size() - 1; a++)
-                {
-                    if (description[a] == '\\' && description[a + 1] == 'x')
-                    {
-                        auto value = description.substr(a + 2, 2);
-                        char letter = std::stoull(value, nullptr, 16);
-                        description.insert(description.begin() + a, letter);
-                        description.erase(a + 1, 4);
-                    }
-                }
-
-                service_info.id = (id);
-                service_info.display_name = (id);
-                service_info.description = (description);
-
-                auto type = id.substr(id.find_last_of('.') + 1);
-                type[0] = std::toupper(type[0]);
-                service_info.type = (type);
-
-                auto enabled_state = service_interface.get<std::string>("UnitFileState");
-                if (enabled_state == "enabled" || enabled_state == "static")
-                    service_info.enabled = (true);
-
-                auto active_state = service_interface.get<std::string>("ActiveState");
-                if (active_state == "inactive")
-                    service_info.state = (Bakaneko::Service::State::Stopped);
-                if (active_state == "failed")
-                    service_info.state = (Bakaneko::Service::State::Stopped);
-                if (active_state == "active")
-                    service_info.state = (Bakaneko::Service::State::Running);
-                if (active_state == "activating")
-                    service_info.state = (Bakaneko::Service::State::Starting);
-                if (active_state == "deactivating")
-                    service_info.state = (Bakaneko::Service::State::Stopping);
+                if (fragments.find(unit.fragment_path) == fragments.end())
+                    describe_unit(info.services.emplace_back(), unit);
             }
         }
         catch (const ljh::unix::dbus::error &e)
@@ -353,32 +307,21 @@ ljh::expected<Bakaneko::Services, Errors> Info::Services(const Fields &fields, B
 
     case service_manager::openrc:
     {
-        auto run_levels = rc_runlevel_list();
-        for (auto &service_file_thing : std::filesystem::directory_iterator(RC_INITDIR))
-        {
-            auto id = service_file_thing.path().filename().string();
-            if (!rc_service_exists(id.c_str()))
-                continue;
+        auto index = Runlevels::index();
+        if (!index)
+            index = std::make_shared<const Runlevels::Index>(Runlevels::scan());
 
+        for (auto &id : index->services)
+        {
             auto &service = info.services.emplace_back();
 
-            auto desc = rc_service_description(id.c_str(), nullptr);
-
             service.id = (id);
             service.display_name = (id);
-            service.description = (desc);
-
-            free(desc);
+            service.description = (Runlevels::description(id));
 
             service.type = ("Service");
 
-            for (auto np = run_levels->tqh_first; np != NULL; np = np->entries.tqe_next)
-            {
-                if (rc_service_in_runlevel(id.c_str(), np->value))
-                {
-                    service.enabled = (true);
-                }
-            }
+            service.enabled = (index->runlevels.find(id) != index->runlevels.end());
 
             auto state = rc_service_state(id.c_str());
             if ((state & RC_SERVICE(0xFF)) == RC_SERVICE::STARTED)
@@ -388,7 +331,6 @@ ljh::expected<Bakaneko::Services, Errors> Info::Services(const Fields &fields, B
             else if ((state & RC_SERVICE(0xFF)) == RC_SERVICE::STOPPING)
                 service.state = (Bakaneko::Service::State::Stopping);
         }
-        rc_stringlist_free(run_levels);
     }
     break;
 
@@ -450,7 +392,7 @@ ljh::expected<void, Errors> Control::Service(const Fields &fields, Bakaneko::Ser
             bool _1;
             std::vector<std::tuple<std::string, std::string, std::string>> _2;
 
-            ljh::unix::dbus::connection system_bus(ljh::unix::dbus::bus::SYSTEM);
+            auto system_bus = Bus::system();
             auto interface = system_bus.get("org.freedesktop.systemd1", "/org/freedesktop/systemd1", "org.freedesktop.systemd1.Manager");
             auto unit_path = interface.call("LoadUnit").args(data.id).run<ljh::unix::dbus::object_path>();
             auto service_interface = system_bus.get("org.freedesktop.systemd1", unit_path.data(), "org.freedesktop.systemd1.Unit");
@@ -532,6 +474,7 @@ ljh::expected<void, Errors> Control::Service(const Fields &fields, Bakaneko::Ser
         {
             if (!rc_service_add("default", data.id.c_str()))
                 return ljh::unexpected{Errors::Failed};
+            Runlevels::refresh();
         }
         break;
         case Bakaneko::Service::Control::Action::Disable:
@@ -545,6 +488,7 @@ ljh::expected<void, Errors> Control::Service(const Fields &fields, Bakaneko::Ser
                 }
             }
             rc_stringlist_free(run_levels);
+            Runlevels::refresh();
         }
         break;
         default:
@@ -0,0 +1,408 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "stream.hpp"
+#include "cache.hpp"
+#include "config.hpp"
+#include "json_writer.hpp"
+#include "subscriptions.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <map>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
+
+#include <ljh/function_traits.hpp>
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+// Messages a client may have queued before it is considered too slow to keep
+// up and is dropped. It gets a full snapshot again when it reconnects.
+static constexpr std::size_t max_queued_messages = 64;
+
+class Rest::Sampler::Channel
+{
+public:
+    const std::string_view name;
+
+protected:
+    Sampler& sampler;
+    asio::strand<asio::io_context::executor_type> strand;
+    asio::steady_timer timer;
+    std::vector<std::weak_ptr<Stream>> subscribers;
+    std::uint64_t revision = 0;
+    bool running = false;
+
+    // Collects a new sample off the strand, then calls apply() and schedule()
+    // back on it.
+    virtual void sample() = 0;
+    // Every record at the current revision, or nullptr before the first
+    // sample has come in.
+    virtual std::shared_ptr<const std::string> snapshot() = 0;
+    virtual void reset() = 0;
+    virtual std::chrono::milliseconds interval() const = 0;
+
+    void broadcast(const std::shared_ptr<const std::string>& message)
+    {
+        for (auto& subscriber : subscribers)
+        {
+            if (auto stream = subscriber.lock())
+                stream->push(message);
+        }
+    }
+
+    void schedule()
+    {
+        subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), [](auto& subscriber) { return subscriber.expired(); }), subscribers.end());
+        if (subscribers.empty())
+        {
+            running = false;
+            revision = 0;
+            reset();
+            return;
+        }
+
+        timer.expires_after(interval());
+        timer.async_wait(asio::bind_executor(strand, [this, self = sampler.shared_from_this()](boost::system::error_code ec) {
+            if (!ec)
+                sample();
+        }));
+    }
+
+public:
+    Channel(std::string_view name, Sampler& sampler, asio::io_context& io_context)
+        : name(name), sampler(sampler), strand(io_context.get_executor()), timer(io_context)
+    {}
+
+    virtual ~Channel() = default;
+
+    void subscribe(std::shared_ptr<Stream> stream)
+    {
+        asio::dispatch(strand, [this, self = sampler.shared_from_this(), stream = std::move(stream)] {
+            subscribers.push_back(stream);
+            if (!running)
+            {
+                running = true;
+                return sample();
+            }
+            if (auto message = snapshot())
+                stream->push(std::move(message));
+        });
+    }
+
+    void unsubscribe(const Stream* stream)
+    {
+        asio::dispatch(strand, [this, self = sampler.shared_from_this(), stream] {
+            subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), [stream](auto& subscriber) {
+                auto locked = subscriber.lock();
+                return !locked || locked.get() == stream;
+            }), subscribers.end());
+        });
+    }
+};
+
+namespace
+{
+    // What a record is compared by between samples.
+    template <typename Record>
+    std::string fingerprint(const Record& record)
+    {
+        return Json::dump(record);
+    }
+
+    // Every sample stamps an adapter with the sampling clock, leave that out
+    // so only state, addresses and counters count as a change.
+    std::string fingerprint(const Bakaneko::Adapter& record)
+    {
+        auto copy = record;
+        copy.time = 0;
+        copy.interval = 0;
+        return Json::dump(copy);
+    }
+
+    // A section backed by a collector returning a list of records, keyed by
+    // one of their members. A record counts as changed when its fingerprint
+    // differs from the last sample's.
+    template <auto function, typename Changes, auto list, auto key>
+    class Section : public Rest::Sampler::Channel
+    {
+        using FunctionTraits = ljh::function_traits<decltype(function)>;
+        using List   = typename FunctionTraits::return_type::value_type;
+        using Record = typename std::remove_reference_t<decltype(std::declval<List&>().*list)>::value_type;
+
+        std::string_view route;
+        Executor::Pool pool;
+        std::chrono::milliseconds Config::Stream::* setting;
+        std::map<std::string, std::pair<Record, std::string>, std::less<>> records;
+
+        void sample() override
+        {
+            asio::post(Executor::get(pool), [this, self = sampler.shared_from_this()] {
+                std::optional<List> result;
+                try
+                {
+                    Fields fields;
+                    std::string cache_key{route.data(), route.size()};
+                    cache_key += '\n';
+
+                    auto message_res = [&] {
+                        if constexpr (FunctionTraits::argument_count < 2)
+                        {
+                            return Collect<function>(route, cache_key, fields);
+                        }
+                        else
+                        {
+                            typename FunctionTraits::template argument_type<1> message_req;
+                            return Collect<function>(route, cache_key, fields, message_req);
+                        }
+                    }();
+
+                    if (message_res.has_value())
+                        result = std::move(*message_res);
+                }
+                catch (const std::exception& e)
+                {
+                    spdlog::error(e.what());
+                }
+
+                asio::post(strand, [this, self, result = std::move(result)]() mutable {
+                    if (result)
+                        apply(std::move(*result));
+                    schedule();
+                });
+            });
+        }
+
+        void apply(List&& value)
+        {
+            Changes changes;
+            changes.section = std::string{name};
+            changes.full = revision == 0;
+
+            decltype(records) next;
+            for (auto& record : value.*list)
+            {
+                auto serialized = fingerprint(record);
+                auto previous = records.find(record.*key);
+                if (changes.full || previous == records.end() || previous->second.second != serialized)
+                    changes.changed.push_back(record);
+                auto id = record.*key;
+                next.insert_or_assign(std::move(id), std::pair{std::move(record), std::move(serialized)});
+            }
+            for (auto& [id, record] : records)
+            {
+                if (next.find(id) == next.end())
+                    changes.removed.push_back(id);
+            }
+            records = std::move(next);
+
+            if (!changes.full && changes.changed.empty() && changes.removed.empty())
+                return;
+
+            changes.revision = ++revision;
+            broadcast(std::make_shared<const std::string>(Json::dump(changes)));
+        }
+
+        std::shared_ptr<const std::string> snapshot() override
+        {
+            if (revision == 0)
+                return nullptr;
+
+            Changes changes;
+            changes.section = std::string{name};
+            changes.revision = revision;
+            changes.full = true;
+            for (auto& [id, record] : records)
+                changes.changed.push_back(record.first);
+            return std::make_shared<const std::string>(Json::dump(changes));
+        }
+
+        void reset() override
+        {
+            records.clear();
+        }
+
+        std::chrono::milliseconds interval() const override
+        {
+            return config.stream.*setting;
+        }
+
+    public:
+        Section(std::string_view name, std::string_view route, Executor::Pool pool, std::chrono::milliseconds Config::Stream::* setting, Rest::Sampler& sampler, asio::io_context& io_context)
+            : Channel(name, sampler, io_context), route(route), pool(pool), setting(setting)
+        {}
+    };
+}
+
+Rest::Sampler::Sampler(asio::io_context& io_context)
+{
+    using Pool = Executor::Pool;
+    channels.push_back(std::make_unique<Section<&Info::Adapters, Bakaneko::AdapterChanges, &Bakaneko::Adapters::adapters, &Bakaneko::Adapter::name    >>("network/adapters", "/network/adapters", Pool::Fast, &Config::Stream::adapters, *this, io_context));
+    channels.push_back(std::make_unique<Section<&Info::Services, Bakaneko::ServiceChanges, &Bakaneko::Services::services, &Bakaneko::Service::id      >>("services"        , "/services"        , Pool::Slow, &Config::Stream::services, *this, io_context));
+    channels.push_back(std::make_unique<Section<&Info::Drives  , Bakaneko::DriveChanges  , &Bakaneko::Drives::drives    , &Bakaneko::Drive::dev_node  >>("drives"          , "/drives"          , Pool::Slow, &Config::Stream::drives  , *this, io_context));
+}
+
+Rest::Sampler::~Sampler() = default;
+
+auto Rest::Sampler::find(std::string_view section) const -> Channel*
+{
+    for (auto& channel : channels)
+    {
+        if (channel->name == section)
+            return channel.get();
+    }
+    return nullptr;
+}
+
+bool Rest::Sampler::subscribe(std::string_view section, const std::shared_ptr<Stream>& stream)
+{
+    auto channel = find(section);
+    if (channel == nullptr)
+        return false;
+    channel->subscribe(stream);
+    return true;
+}
+
+void Rest::Sampler::unsubscribe(std::string_view section, const Stream* stream)
+{
+    if (auto channel = find(section); channel != nullptr)
+        channel->unsubscribe(stream);
+}
+
+Rest::Stream::Stream(socket_type&& socket, std::shared_ptr<Sampler> sampler)
+#if BOOST_VERSION < 107000
+    : ws(std::move(socket)), strand(ws.get_executor()), sampler(std::move(sampler))
+#else
+    : ws(std::move(socket)), sampler(std::move(sampler))
+#endif
+{
+}
+
+auto Rest::Stream::executor() -> executor_type
+{
+#if BOOST_VERSION < 107000
+    return strand;
+#else
+    return ws.get_executor();
+#endif
+}
+
+void Rest::Stream::run(Request&& req)
+{
+#if BOOST_VERSION < 107000
+    ws.async_accept(req, asio::bind_executor(strand, std::bind(&Stream::on_accept, shared_from_this(), std::placeholders::_1)));
+#else
+    // The WebSocket pings keep it alive and notice dead peers from here on.
+    beast::get_lowest_layer(ws).expires_never();
+    ws.set_option(beast::websocket::stream_base::timeout::suggested(beast::role_type::server));
+    ws.set_option(beast::websocket::stream_base::decorator([](beast::websocket::response_type& res) {
+        res.set(beast::http::field::server, "Bakaneko/" BAKANEKO_VERSION_STRING);
+    }));
+    ws.async_accept(req, beast::bind_front_handler(&Stream::on_accept, shared_from_this()));
+#endif
+}
+
+void Rest::Stream::on_accept(boost::system::error_code ec)
+{
+    if (ec)
+        return;
+
+    ws.text(true);
+    do_read();
+}
+
+void Rest::Stream::do_read()
+{
+#if BOOST_VERSION < 107000
+    ws.async_read(buffer, asio::bind_executor(strand, std::bind(&Stream::on_read, shared_from_this(), std::placeholders::_1, std::placeholders::_2)));
+#else
+    ws.async_read(buffer, beast::bind_front_handler(&Stream::on_read, shared_from_this()));
+#endif
+}
+
+void Rest::Stream::on_read(boost::system::error_code ec, std::size_t bytes_transferred)
+{
+    boost::ignore_unused(bytes_transferred);
+
+    if (ec)
+        return update({});
+
+    try
+    {
+        Bakaneko::StreamRequest request = json::parse(beast::buffers_to_string(buffer.data()));
+        update(std::move(request.subscribe));
+    }
+    catch (const std::exception& e)
+    {
+        spdlog::get("networking")->warn("Bad /stream request: {}", e.what());
+    }
+
+    buffer.consume(buffer.size());
+    do_read();
+}
+
+void Rest::Stream::update(std::vector<std::string> subscribe)
+{
+    std::sort(subscribe.begin(), subscribe.end());
+    subscribe.erase(std::unique(subscribe.begin(), subscribe.end()), subscribe.end());
+
+    for (auto& section : sections)
+    {
+        if (!std::binary_search(subscribe.begin(), subscribe.end(), section))
+            sampler->unsubscribe(section, this);
+    }
+
+    std::vector<std::string> accepted;
+    for (auto& section : subscribe)
+    {
+        if (std::binary_search(sections.begin(), sections.end(), section) || sampler->subscribe(section, shared_from_this()))
+            accepted.push_back(std::move(section));
+    }
+    sections = std::move(accepted);
+}
+
+void Rest::Stream::push(std::shared_ptr<const std::string> message)
+{
+    asio::post(executor(), [self = shared_from_this(), message = std::move(message)]() mutable {
+        if (self->queue.size() >= max_queued_messages)
+        {
+#if BOOST_VERSION < 107000
+            boost::system::error_code ec;
+            self->ws.next_layer().close(ec);
+#else
+            beast::get_lowest_layer(self->ws).close();
+#endif
+            return;
+        }
+
+        self->queue.push_back(std::move(message));
+        if (self->queue.size() == 1)
+            self->do_write();
+    });
+}
+
+void Rest::Stream::do_write()
+{
+    auto& message = *queue.front();
+#if BOOST_VERSION < 107000
+    ws.async_write(asio::buffer(message), asio::bind_executor(strand, std::bind(&Stream::on_write, shared_from_this(), std::placeholders::_1, std::placeholders::_2)));
+#else
+    ws.async_write(asio::buffer(message), beast::bind_front_handler(&Stream::on_write, shared_from_this()));
+#endif
+}
+
+void Rest::Stream::on_write(boost::system::error_code ec, std::size_t bytes_transferred)
+{
+    boost::ignore_unused(bytes_transferred);
+
+    if (ec)
+        return;
+
+    queue.pop_front();
+    if (!queue.empty())
+        do_write();
+}
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <string_view>
+
+#include <boost/beast/websocket.hpp>
+
+#include "rest.hpp"
+
+namespace Rest
+{
+    class Stream;
+
+    // Samples the /stream sections on a timer while anyone is subscribed to
+    // them, and pushes what changed since the last sample to every
+    // subscriber. Each change is serialized once no matter how many streams
+    // it goes to.
+    class Sampler : public std::enable_shared_from_this<Sampler>
+    {
+    public:
+        class Channel;
+
+    private:
+        std::vector<std::unique_ptr<Channel>> channels;
+
+        Channel* find(std::string_view section) const;
+
+    public:
+        explicit Sampler(asio::io_context& io_context);
+        ~Sampler();
+
+        // Returns false for sections that can't be streamed.
+        bool subscribe(std::string_view section, const std::shared_ptr<Stream>& stream);
+        void unsubscribe(std::string_view section, const Stream* stream);
+    };
+
+    // One client on /stream. Reads subscription requests and writes the
+    // messages the sampler hands it, in order.
+    class Stream : public std::enable_shared_from_this<Stream>
+    {
+#if BOOST_VERSION < 107000
+        using socket_type   = asio::ip::tcp::socket;
+        using executor_type = asio::strand<asio::io_context::executor_type>;
+        beast::websocket::stream<socket_type> ws;
+        executor_type strand;
+#else
+        using socket_type   = beast::tcp_stream;
+        using executor_type = beast::tcp_stream::executor_type;
+        beast::websocket::stream<socket_type> ws;
+#endif
+        std::shared_ptr<Sampler> sampler;
+        beast::flat_buffer buffer;
+        std::deque<std::shared_ptr<const std::string>> queue;
+        std::vector<std::string> sections;
+
+        executor_type executor();
+
+        void on_accept(boost::system::error_code ec);
+        void do_read();
+        void on_read(boost::system::error_code ec, std::size_t bytes_transferred);
+        void do_write();
+        void on_write(boost::system::error_code ec, std::size_t bytes_transferred);
+        void update(std::vector<std::string> subscribe);
+
+    public:
+        Stream(socket_type&& socket, std::shared_ptr<Sampler> sampler);
+
+        // Finishes the WebSocket handshake for the upgrade request.
+        void run(Request&& req);
+
+        // Queues a message for this client. Safe to call from any thread.
+        void push(std::shared_ptr<const std::string> message);
+    };
+}
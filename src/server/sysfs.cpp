@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "sysfs.hpp"
+
+#include <ljh/system_info.hpp>
+
+#if defined(LJH_TARGET_Linux)
+#include <mutex>
+#include <memory>
+#include <cerrno>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace
+{
+    // A few attributes for every drive, partition and adapter fit easily,
+    // the limit only matters on machines with a lot of churning devices.
+    constexpr std::size_t max_open = 256;
+
+    // Closed once it's out of the table and nobody is reading it.
+    struct Descriptor
+    {
+        int fd;
+        // What the path named when it was opened.
+        dev_t device;
+        ino_t inode;
+
+        Descriptor(int fd, const struct stat& info)
+            : fd(fd), device(info.st_dev), inode(info.st_ino)
+        {}
+
+        ~Descriptor()
+        {
+            close(fd);
+        }
+
+        Descriptor(const Descriptor&) = delete;
+        Descriptor& operator=(const Descriptor&) = delete;
+    };
+
+    std::mutex lock;
+    std::unordered_map<std::string, std::shared_ptr<Descriptor>> descriptors;
+
+    std::shared_ptr<Descriptor> open_file(const std::string& path)
+    {
+        // A renamed adapter keeps its kernfs node, so a kept descriptor for
+        // /sys/class/net/eth0 goes on reading the old device after another
+        // one takes the name. The path still has to name the same node.
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            return nullptr;
+
+        {
+            std::lock_guard guard{lock};
+            if (auto found = descriptors.find(path); found != descriptors.end())
+            {
+                if (found->second->device == info.st_dev && found->second->inode == info.st_ino)
+                    return found->second;
+                descriptors.erase(found);
+            }
+        }
+
+        auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return nullptr;
+        if (fstat(fd, &info) != 0)
+        {
+            close(fd);
+            return nullptr;
+        }
+        auto opened = std::make_shared<Descriptor>(fd, info);
+
+        std::lock_guard guard{lock};
+        if (descriptors.size() >= max_open)
+            descriptors.erase(descriptors.begin());
+        // Another thread may have opened it meanwhile, the newest wins.
+        return descriptors.insert_or_assign(path, std::move(opened)).first->second;
+    }
+
+    void forget(const std::string& path, const std::shared_ptr<Descriptor>& descriptor)
+    {
+        std::lock_guard guard{lock};
+        if (auto found = descriptors.find(path); found != descriptors.end() && found->second == descriptor)
+            descriptors.erase(found);
+    }
+
+    bool read_all(int fd, std::string& buffer)
+    {
+        // Sysfs attributes are at most a page, procfs files can be longer.
+        if (buffer.size() < 4096)
+            buffer.resize(4096);
+
+        std::size_t total = 0;
+        for (;;)
+        {
+            auto got = pread(fd, buffer.data() + total, buffer.size() - total, total);
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got < 0)
+                return false;
+            if (got == 0)
+                break;
+            total += got;
+            if (total == buffer.size())
+                buffer.resize(buffer.size() * 2);
+        }
+        buffer.resize(total);
+        return true;
+    }
+}
+
+std::optional<std::string_view> Sysfs::view(const std::filesystem::path& path)
+{
+    // Keeps its capacity between reads.
+    thread_local std::string buffer;
+
+    auto name = path.string();
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        auto descriptor = open_file(name);
+        if (descriptor == nullptr)
+            return std::nullopt;
+        buffer.resize(buffer.capacity());
+        if (read_all(descriptor->fd, buffer))
+            return std::string_view{buffer};
+
+        // The device behind it went away (ENODEV), and something else may
+        // have taken its name since.
+        forget(name, descriptor);
+    }
+    return std::nullopt;
+}
+#else
+std::optional<std::string_view> Sysfs::view(const std::filesystem::path& path)
+{
+    return std::nullopt;
+}
+#endif
+
+std::string Sysfs::read(const std::filesystem::path& path)
+{
+    return std::string{view(path).value_or(std::string_view{})};
+}
+
+std::string Sysfs::value(const std::filesystem::path& path)
+{
+    auto contents = view(path).value_or(std::string_view{});
+    contents = contents.substr(0, contents.find('\n'));
+    while (!contents.empty() && std::isspace(static_cast<unsigned char>(contents.back())))
+        contents.remove_suffix(1);
+    return std::string{contents};
+}
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <string>
+#include <cctype>
+#include <charconv>
+#include <optional>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+
+// Reads sysfs and procfs files. Their contents are generated on every read
+// from offset 0, so the descriptors of files that were read are kept open
+// and read again with pread into a per-thread buffer, instead of opening
+// them every time. A kept descriptor is only reused while its path still
+// names the same node. Not for regular files, which can be replaced under
+// an open descriptor. Linux only.
+namespace Sysfs
+{
+    // The whole file, nullopt if it can't be read. Only valid until the
+    // calling thread reads another file.
+    std::optional<std::string_view> view(const std::filesystem::path& path);
+
+    // The whole file, empty if it can't be read.
+    std::string read(const std::filesystem::path& path);
+
+    // The first line without trailing whitespace, like most attributes
+    // hold, empty if it can't be read.
+    std::string value(const std::filesystem::path& path);
+
+    // The number the file starts with, nullopt if it can't be read or
+    // doesn't start with one.
+    template <typename T>
+    std::optional<T> number(const std::filesystem::path& path)
+    {
+        auto contents = view(path);
+        if (!contents)
+            return std::nullopt;
+
+        auto begin = contents->data(), end = begin + contents->size();
+        while (begin != end && std::isspace(static_cast<unsigned char>(*begin)))
+            begin++;
+
+        T number{};
+        if (std::from_chars(begin, end, number).ec != std::errc{})
+            return std::nullopt;
+        return number;
+    }
+}
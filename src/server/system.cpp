@@ -2,6 +2,8 @@
 // SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
 
 #include "info.hpp"
+#include "host.hpp"
+#include "sysfs.hpp"
 
 #include <cstdlib>
 #include <fstream>
@@ -34,12 +36,14 @@
 #include <linux/reboot.h>
 #include <unistd.h>
 #include <ifaddrs.h>
+#include "bus.hpp"
 #endif
 
+#include <spdlog/spdlog.h>
+
 #undef interface
 
 inline std::string chassis_type_as_system_icon(int a);
-extern std::string read_file(std::filesystem::path file_path);
 
 std::string remove_quotes(std::string input)
 {
@@ -48,9 +52,9 @@ std::string remove_quotes(std::string input)
     return input;
 }
 
-ljh::expected<Bakaneko::System, Errors> Info::System(const Fields &fields)
+ljh::expected<Bakaneko::System, Errors> read_system()
 {
-    decltype(Info::System(fields))::value_type system;
+    Bakaneko::System system;
 
     char ip_address[47];
     memset(ip_address, 0, sizeof(ip_address));
@@ -136,8 +140,8 @@ ljh::expected<Bakaneko::System, Errors> Info::System(const Fields &fields)
 
     if (icon == "unknown")
     {
-        if (std::filesystem::exists("/sys/class/dmi/id/chassis_type"))
-            icon = chassis_type_as_system_icon(std::stoi(read_file("/sys/class/dmi/id/chassis_type")));
+        if (auto chassis_type = Sysfs::number<int>("/sys/class/dmi/id/chassis_type"))
+            icon = chassis_type_as_system_icon(*chassis_type);
     }
 
     struct ifaddrs *base;
@@ -198,6 +202,20 @@ GOT_ADDRESS:
     return std::move(system);
 }
 
+ljh::expected<Bakaneko::System, Errors> Info::System(const Fields &fields)
+{
+    if (auto identity = Host::identity())
+        return *identity;
+
+    // Both before reading, so a change while it's read is caught next time.
+    auto generation = Host::generation();
+    auto nodename = Host::nodename();
+    auto system = read_system();
+    if (system)
+        Host::keep(generation, std::move(nodename), *system);
+    return system;
+}
+
 inline std::string chassis_type_as_system_icon(int a)
 {
     switch (a)
@@ -256,6 +274,30 @@ inline std::string chassis_type_as_system_icon(int a)
 
 extern std::tuple<int, std::string> exec(const std::string &cmd);
 
+#if defined(LJH_TARGET_Linux)
+namespace
+{
+    // Asks logind (or elogind) to power off or reboot over the shared system bus,
+    // which doesn't need a poweroff binary or a shell, and goes through the same
+    // inhibitor locks as everything else.
+    bool logind(const char *method)
+    {
+        try
+        {
+            auto system_bus = Bus::system();
+            auto manager = system_bus.get("org.freedesktop.login1", "/org/freedesktop/login1", "org.freedesktop.login1.Manager");
+            manager.call(method).args(false).run<void>();
+            return true;
+        }
+        catch (const ljh::unix::dbus::error &e)
+        {
+            spdlog::debug("DBus Error: ({}) {}", e.name(), e.message());
+            return false;
+        }
+    }
+}
+#endif
+
 namespace Control
 {
     ljh::expected<void, Errors> Shutdown(const Fields &fields)
@@ -265,6 +307,9 @@ namespace Control
             return ljh::unexpected{Errors::Failed};
         return ljh::expected<void, Errors>{};
 #elif defined(LJH_TARGET_Linux)
+        if (logind("PowerOff"))
+            return ljh::expected<void, Errors>{};
+
         auto [exit, _] = exec("poweroff now");
         if (exit != 0)
         {
@@ -287,6 +332,9 @@ namespace Control
             return ljh::unexpected{Errors::Failed};
         return ljh::expected<void, Errors>{};
 #elif defined(LJH_TARGET_Linux)
+        if (logind("Reboot"))
+            return ljh::expected<void, Errors>{};
+
         auto [exit, _] = exec("reboot now");
         if (exit != 0)
         {
@@ -0,0 +1,609 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "systemd.hpp"
+
+#include <ljh/system_info.hpp>
+
+#if defined(LJH_TARGET_Linux)
+#include "bus.hpp"
+#include "executor.hpp"
+
+#include <set>
+#include <deque>
+#include <tuple>
+#include <vector>
+#include <chrono>
+#include <variant>
+#include <optional>
+#include <filesystem>
+#include <string_view>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/bind_executor.hpp>
+
+#include <spdlog/spdlog.h>
+
+namespace
+{
+    constexpr auto systemd_service   = "org.freedesktop.systemd1";
+    constexpr auto manager_path      = "/org/freedesktop/systemd1";
+    constexpr auto manager_interface = "org.freedesktop.systemd1.Manager";
+    constexpr auto unit_interface    = "org.freedesktop.systemd1.Unit";
+
+    // name, description, load state, active state, sub state, following,
+    // object path, job id, job type, job path
+    using unit_list_entry = std::tuple<std::string, std::string, std::string, std::string, std::string, std::string, ljh::unix::dbus::object_path, uint32_t, std::string, ljh::unix::dbus::object_path>;
+    using unit_properties = std::map<std::string, std::variant<std::string>>;
+
+    // The system bus only lets a connection wait on 128 replies by default.
+    constexpr std::size_t max_calls_in_flight = 64;
+
+    // How long to wait before connecting again after losing the bus.
+    constexpr std::chrono::seconds reconnect_delay{5};
+
+    // Calls make(i) for every i below count and hands the replies to
+    // read(i, reply) in order, keeping up to max_calls_in_flight sent ahead
+    // so the whole batch costs a few round trips instead of count of them.
+    template <typename Make, typename Read>
+    void pipeline(std::size_t count, Make&& make, Read&& read)
+    {
+        std::deque<ljh::unix::dbus::message> in_flight;
+        std::size_t sent = 0;
+        for (std::size_t done = 0; done < count; done++)
+        {
+            for (; sent < count && sent - done < max_calls_in_flight; sent++)
+                in_flight.emplace_back(make(sent)).send();
+            read(done, in_flight.front());
+            in_flight.pop_front();
+        }
+    }
+
+    const std::string& property(const unit_properties& properties, const std::string& name)
+    {
+        static const std::string empty;
+        auto found = properties.find(name);
+        return found != properties.end() ? std::get<std::string>(found->second) : empty;
+    }
+
+    // What asking for one unit gave. With neither set the call failed
+    // (timed out, most likely) and the unit should be left as it was.
+    struct Fetched
+    {
+        std::optional<Systemd::Unit> unit;
+        // systemd said there's no such unit any more.
+        bool gone = false;
+    };
+
+    std::vector<Fetched> fetch(ljh::unix::dbus::connection& bus, const std::vector<std::string>& paths)
+    {
+        std::vector<ljh::unix::dbus::interface> interfaces;
+        interfaces.reserve(paths.size());
+        for (auto& path : paths)
+            interfaces.push_back(bus.get(systemd_service, path, unit_interface));
+
+        std::vector<Fetched> units(paths.size());
+        pipeline(
+            paths.size(), [&](std::size_t i) { return interfaces[i].get_all(); },
+            [&](std::size_t i, ljh::unix::dbus::message& reply) {
+                try
+                {
+                    auto properties = reply.run<unit_properties>();
+                    units[i].unit = Systemd::Unit{
+                        property(properties, "Id"),
+                        property(properties, "Description"),
+                        property(properties, "ActiveState"),
+                        property(properties, "UnitFileState"),
+                        property(properties, "FragmentPath"),
+                    };
+                }
+                catch (const ljh::unix::dbus::error& e)
+                {
+                    if (e.name() == DBUS_ERROR_UNKNOWN_OBJECT || e.name() == "org.freedesktop.systemd1.NoSuchUnit")
+                        units[i].gone = true;
+                    else
+                        spdlog::debug("DBus Error: ({}) {}", e.name(), e.message());
+                }
+            });
+        return units;
+    }
+
+    // Owns the table and the connection its signals come in on. Everything
+    // but the listing and fetching, which block and run on the slow pool,
+    // happens on one strand.
+    class Watcher : public std::enable_shared_from_this<Watcher>
+    {
+        Bus::Dispatcher::strand_type strand;
+        std::shared_ptr<Bus::Dispatcher> dispatcher;
+        ljh::unix::dbus::interface manager;
+        asio::steady_timer reconnect;
+        asio::steady_timer fetch_retry;
+
+        Systemd::Units table;
+        bool loaded = false;
+        bool stopped = false;
+
+        // Bumped by every listing and lost connection, so results of work
+        // started before them are dropped.
+        uint64_t epoch = 0;
+        bool listing = false;
+        bool relist = false;
+        // Units changed in ways the signal didn't say, to be fetched again.
+        std::set<std::string> dirty;
+        // Units a fetch failed for, moved back to dirty once fetch_retry
+        // fires, so a struggling bus isn't asked again straight away.
+        std::set<std::string> retrying;
+        bool fetching = false;
+        bool publish_queued = false;
+
+        void connect()
+        {
+            dispatcher = std::make_shared<Bus::Dispatcher>(strand, [this](DBusMessage* signal) { received(signal); }, [this] { lost(); });
+            try
+            {
+                dispatcher->open(ljh::unix::dbus::bus::SYSTEM);
+            }
+            catch (const ljh::unix::dbus::error& e)
+            {
+                dispatcher.reset();
+                // Only keep trying a bus that was there before.
+                if (table.revision == 0)
+                {
+                    spdlog::info("Not watching systemd units, no system bus: ({}) {}", e.name(), e.message());
+                    return;
+                }
+                spdlog::debug("Could not reconnect to the system bus: ({}) {}", e.name(), e.message());
+                return retry();
+            }
+            manager = dispatcher->connection().get(systemd_service, manager_path, manager_interface);
+
+            dispatcher->add_match(fmt::format("type='signal',sender='{}',path='{}',interface='{}'", systemd_service, manager_path, manager_interface));
+            dispatcher->add_match(fmt::format("type='signal',sender='{}',path_namespace='{}/unit',interface='{}',member='PropertiesChanged'", systemd_service, manager_path, DBUS_INTERFACE_PROPERTIES));
+            // systemd only sends unit signals while someone is subscribed.
+            // It unsubscribes us by itself when the connection closes.
+            dispatcher->send(systemd_service, manager_path, manager_interface, "Subscribe");
+
+            list();
+        }
+
+        void retry()
+        {
+            reconnect.expires_after(reconnect_delay);
+            reconnect.async_wait(asio::bind_executor(strand, [this, self = shared_from_this()](boost::system::error_code ec) {
+                if (!ec && !stopped)
+                    connect();
+            }));
+        }
+
+        void lost()
+        {
+            epoch++;
+            loaded = false;
+            listing = false;
+            fetching = false;
+            dirty.clear();
+            retrying.clear();
+            std::atomic_store(&published, std::shared_ptr<const Systemd::Units>{});
+            retry();
+        }
+
+        // Replaces the whole table. Signals that come in while it's being
+        // listed mark their units dirty, the listing may have missed them.
+        void list()
+        {
+            if (listing)
+            {
+                relist = true;
+                return;
+            }
+            listing = true;
+            // Fetches still out are about to be overwritten by this.
+            fetching = false;
+            dirty.clear();
+            retrying.clear();
+
+            asio::post(Executor::get(Executor::Pool::Slow), [this, self = shared_from_this(), epoch = ++epoch] {
+                auto fail = [&](std::string name, std::string message) {
+                    asio::post(strand, [this, self, epoch, name = std::move(name), message = std::move(message)] {
+                        if (epoch == this->epoch)
+                            failed(name, message);
+                    });
+                };
+
+                try
+                {
+                    auto units = std::make_shared<Systemd::Units>(Systemd::list());
+                    asio::post(strand, [this, self, epoch, units] {
+                        if (epoch == this->epoch)
+                            listed(std::move(*units));
+                    });
+                }
+                catch (const ljh::unix::dbus::error& e)
+                {
+                    fail(e.name(), e.message());
+                }
+                catch (const std::exception& e)
+                {
+                    fail({}, e.what());
+                }
+            });
+        }
+
+        void listed(Systemd::Units units)
+        {
+            listing = false;
+            units.revision = table.revision;
+            table = std::move(units);
+            if (!loaded)
+                spdlog::info("Watching {} systemd units", table.loaded.size());
+            loaded = true;
+            publish();
+
+            if (relist)
+            {
+                relist = false;
+                return list();
+            }
+            refetch();
+        }
+
+        void failed(const std::string& name, const std::string& message)
+        {
+            listing = false;
+            relist = false;
+            if (name == DBUS_ERROR_SERVICE_UNKNOWN)
+            {
+                // Not a systemd machine, nothing to watch.
+                spdlog::debug("systemd isn't on the system bus, not watching units");
+                stopped = true;
+                dispatcher->close();
+                return;
+            }
+
+            spdlog::warn("Listing systemd units failed: ({}) {}", name, message);
+            lost();
+            dispatcher->close();
+        }
+
+        void refetch()
+        {
+            if (fetching || listing || !loaded || dirty.empty())
+                return;
+            fetching = true;
+
+            std::vector<std::string> paths{dirty.begin(), dirty.end()};
+            dirty.clear();
+            asio::post(Executor::get(Executor::Pool::Slow), [this, self = shared_from_this(), epoch = epoch, paths = std::move(paths)] {
+                // Left as failed when the whole batch couldn't be asked.
+                std::vector<Fetched> units(paths.size());
+                try
+                {
+                    auto system_bus = Bus::system();
+                    units = fetch(system_bus, paths);
+                }
+                catch (const ljh::unix::dbus::error& e)
+                {
+                    // The dispatcher hears about the bus going away too.
+                    spdlog::debug("DBus Error: ({}) {}", e.name(), e.message());
+                }
+                catch (const std::exception& e)
+                {
+                    spdlog::debug("Fetching systemd units failed: {}", e.what());
+                }
+                asio::post(strand, [this, self, epoch, paths = std::move(paths), units = std::move(units)]() mutable {
+                    if (epoch != this->epoch)
+                        return;
+                    fetching = false;
+                    for (std::size_t i = 0; i < units.size(); i++)
+                    {
+                        if (units[i].unit)
+                            table.loaded.insert_or_assign(paths[i], std::move(*units[i].unit));
+                        else if (units[i].gone)
+                            unloaded(paths[i]);
+                        else
+                            retrying.insert(paths[i]);
+                    }
+                    publish();
+                    refetch();
+                    retry_fetch();
+                });
+            });
+        }
+
+        void retry_fetch()
+        {
+            if (retrying.empty() || fetch_retry.expiry() > asio::steady_timer::clock_type::now())
+                return;
+            fetch_retry.expires_after(reconnect_delay);
+            fetch_retry.async_wait(asio::bind_executor(strand, [this, self = shared_from_this()](boost::system::error_code ec) {
+                if (ec || stopped)
+                    return;
+                dirty.insert(retrying.begin(), retrying.end());
+                retrying.clear();
+                refetch();
+            }));
+        }
+
+        // A unit systemd let go of is stopped, and if it came from a unit
+        // file it's still listed under that.
+        void unloaded(const std::string& path)
+        {
+            auto unit = table.loaded.find(path);
+            if (unit == table.loaded.end())
+                return;
+
+            auto& [id, description, active_state, unit_file_state, fragment_path] = unit->second;
+            std::error_code ec;
+            if (!fragment_path.empty() && id.find('@') == std::string::npos && std::filesystem::exists(fragment_path, ec))
+                table.files.insert_or_assign(id, Systemd::Unit{id, description, "inactive", unit_file_state, fragment_path});
+            table.loaded.erase(unit);
+        }
+
+        void received(DBusMessage* signal)
+        {
+            if (!loaded && !listing)
+                return;
+
+            ljh::unix::dbus::message message{manager, signal};
+            try
+            {
+                if (dbus_message_is_signal(signal, manager_interface, "UnitNew"))
+                {
+                    std::string id;
+                    ljh::unix::dbus::object_path path;
+                    message.read(id, path);
+                    dirty.emplace(path.data());
+                    refetch();
+                }
+                else if (dbus_message_is_signal(signal, manager_interface, "UnitRemoved"))
+                {
+                    std::string id;
+                    ljh::unix::dbus::object_path path;
+                    message.read(id, path);
+                    dirty.erase(path.data());
+                    retrying.erase(path.data());
+                    unloaded(path.data());
+                    publish();
+                }
+                else if (dbus_message_is_signal(signal, manager_interface, "UnitFilesChanged"))
+                {
+                    // Enabled or disabled, which can change any number of
+                    // units' UnitFileState.
+                    list();
+                }
+                else if (dbus_message_is_signal(signal, manager_interface, "Reloading"))
+                {
+                    bool active = false;
+                    message.read(active);
+                    if (!active)
+                        list();
+                }
+                else if (dbus_message_is_signal(signal, DBUS_INTERFACE_PROPERTIES, "PropertiesChanged"))
+                {
+                    std::string interface;
+                    unit_properties changed;
+                    std::vector<std::string> invalidated;
+                    message.read(interface, changed, invalidated);
+                    if (interface != unit_interface || dbus_message_get_path(signal) == nullptr)
+                        return;
+
+                    std::string path = dbus_message_get_path(signal);
+                    auto unit = table.loaded.find(path);
+                    if (unit == table.loaded.end() || listing || !invalidated.empty())
+                    {
+                        dirty.insert(path);
+                        refetch();
+                    }
+                    if (unit == table.loaded.end())
+                        return;
+
+                    for (auto [name, member] : {
+                             std::pair{"Description"  , &Systemd::Unit::description    },
+                             std::pair{"ActiveState"  , &Systemd::Unit::active_state   },
+                             std::pair{"UnitFileState", &Systemd::Unit::unit_file_state},
+                             std::pair{"FragmentPath" , &Systemd::Unit::fragment_path  },
+                         })
+                    {
+                        if (auto value = changed.find(name); value != changed.end())
+                            unit->second.*member = std::get<std::string>(value->second);
+                    }
+                    publish();
+                }
+            }
+            catch (const std::exception& e)
+            {
+                spdlog::debug("Ignoring a systemd signal that couldn't be read: {}", e.what());
+            }
+        }
+
+        // Hands readers a copy of the table, at most once per trip through
+        // the strand however many signals came in.
+        void publish()
+        {
+            table.revision++;
+            if (publish_queued || !loaded)
+                return;
+            publish_queued = true;
+            asio::post(strand, [this, self = shared_from_this()] {
+                publish_queued = false;
+                if (loaded)
+                    std::atomic_store(&published, std::shared_ptr<const Systemd::Units>{std::make_shared<Systemd::Units>(table)});
+            });
+        }
+
+    public:
+        static inline std::shared_ptr<const Systemd::Units> published;
+
+        explicit Watcher(asio::io_context& io_context)
+            : strand(io_context.get_executor()), reconnect(io_context), fetch_retry(io_context)
+        {}
+
+        void start()
+        {
+            asio::post(strand, [this, self = shared_from_this()] { connect(); });
+        }
+
+        void stop()
+        {
+            stopped = true;
+            epoch++;
+            reconnect.cancel();
+            fetch_retry.cancel();
+            if (dispatcher)
+                dispatcher->close();
+            dispatcher.reset();
+            std::atomic_store(&published, std::shared_ptr<const Systemd::Units>{});
+        }
+    };
+
+    std::shared_ptr<Watcher> watcher;
+}
+
+Systemd::Units Systemd::list()
+{
+    auto system_bus = Bus::system();
+    auto interface = system_bus.get(systemd_service, manager_path, manager_interface);
+
+    // Both lists are in flight before waiting on either.
+    auto list_units = interface.call("ListUnits");
+    auto list_unit_files = interface.call("ListUnitFiles");
+    list_units.send();
+    list_unit_files.send();
+    auto listed = list_units.run<std::vector<unit_list_entry>>();
+    auto unit_files = list_unit_files.run<std::vector<std::tuple<std::string, std::string>>>();
+
+    // ListUnits already gives the name, description and active state, only
+    // FragmentPath and UnitFileState need asking each unit for.
+    std::vector<ljh::unix::dbus::interface> unit_interfaces;
+    unit_interfaces.reserve(listed.size());
+    for (auto& unit : listed)
+        unit_interfaces.push_back(system_bus.get(systemd_service, std::get<6>(unit).data(), unit_interface));
+
+    Units units;
+    std::set<std::string_view> fragments;
+    pipeline(
+        listed.size(), [&](std::size_t i) { return unit_interfaces[i].get_all(); },
+        [&](std::size_t i, ljh::unix::dbus::message& reply) {
+            // A unit that went away since ListUnits is still listed with
+            // what ListUnits said about it.
+            unit_properties properties;
+            try
+            {
+                properties = reply.run<unit_properties>();
+            }
+            catch (const ljh::unix::dbus::error& e)
+            {
+                spdlog::debug("DBus Error: ({}) {}", e.name(), e.message());
+            }
+
+            auto& [id, description, load_state, active_state, sub_state, following, path, job_id, job_type, job_path] = listed[i];
+            auto& unit = units.loaded[path.data()] = Unit{id, description, active_state, property(properties, "UnitFileState"), property(properties, "FragmentPath")};
+            if (!unit.fragment_path.empty())
+                fragments.emplace(unit.fragment_path);
+        });
+
+    // Unit files nothing has loaded yet, UnitFileState comes with the list
+    // but the description and state need the unit loaded.
+    std::vector<Unit> unloaded;
+    for (auto& [file, state] : unit_files)
+    {
+        if (fragments.find(file) != fragments.end())
+            continue;
+        if (file.find('@') != std::string::npos)
+            continue;
+        unloaded.push_back({file.substr(file.find_last_of('/') + 1), {}, {}, state, file});
+    }
+
+    // Kept by index, a unit file that fails to load leaves its slot empty
+    // rather than shifting every later unit onto the wrong path.
+    std::vector<std::optional<ljh::unix::dbus::interface>> unloaded_interfaces(unloaded.size());
+    pipeline(
+        unloaded.size(),
+        [&](std::size_t i) {
+            auto call = interface.call("LoadUnit");
+            call.args(unloaded[i].id);
+            return call;
+        },
+        [&](std::size_t i, ljh::unix::dbus::message& reply) {
+            try
+            {
+                auto unit_path = reply.run<ljh::unix::dbus::object_path>();
+                unloaded_interfaces[i].emplace(system_bus.get(systemd_service, unit_path.data(), unit_interface));
+            }
+            catch (const ljh::unix::dbus::error& e)
+            {
+                spdlog::debug("DBus Error: ({}) {}", e.name(), e.message());
+            }
+        });
+
+    // One that couldn't be loaded is still listed, with what ListUnitFiles
+    // said about it.
+    std::vector<std::size_t> loaded;
+    loaded.reserve(unloaded.size());
+    for (std::size_t i = 0; i < unloaded.size(); i++)
+    {
+        if (unloaded_interfaces[i])
+            loaded.push_back(i);
+        else
+            units.files.insert_or_assign(unloaded[i].id, unloaded[i]);
+    }
+
+    pipeline(
+        loaded.size(), [&](std::size_t i) { return unloaded_interfaces[loaded[i]]->get_all(); },
+        [&](std::size_t i, ljh::unix::dbus::message& reply) {
+            unit_properties properties;
+            try
+            {
+                properties = reply.run<unit_properties>();
+            }
+            catch (const ljh::unix::dbus::error& e)
+            {
+                spdlog::debug("DBus Error: ({}) {}", e.name(), e.message());
+            }
+
+            auto& unit = unloaded[loaded[i]];
+            unit.description = property(properties, "Description");
+            unit.active_state = property(properties, "ActiveState");
+            units.files.insert_or_assign(unit.id, std::move(unit));
+        });
+
+    return units;
+}
+
+void Systemd::start(asio::io_context& io_context)
+{
+    watcher = std::make_shared<Watcher>(io_context);
+    watcher->start();
+}
+
+void Systemd::stop()
+{
+    if (watcher)
+        watcher->stop();
+    watcher.reset();
+}
+
+std::shared_ptr<const Systemd::Units> Systemd::units()
+{
+    return std::atomic_load(&Watcher::published);
+}
+#else
+Systemd::Units Systemd::list()
+{
+    return {};
+}
+
+void Systemd::start(asio::io_context& io_context)
+{
+}
+
+void Systemd::stop()
+{
+}
+
+std::shared_ptr<const Systemd::Units> Systemd::units()
+{
+    return nullptr;
+}
+#endif
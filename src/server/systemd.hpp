@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include <boost/asio/io_context.hpp>
+
+namespace asio = boost::asio;
+
+// systemd's units and unit files. Listing them takes a few hundred D-Bus
+// calls however they're batched, so once started the server lists them
+// once and keeps the table current from systemd's UnitNew, UnitRemoved and
+// PropertiesChanged signals, listing again only when unit files change or
+// systemd reloads. Linux only.
+namespace Systemd
+{
+    struct Unit
+    {
+        std::string id;
+        std::string description;
+        std::string active_state;
+        std::string unit_file_state;
+        std::string fragment_path;
+    };
+
+    struct Units
+    {
+        // Goes up with every change to the table.
+        uint64_t revision = 0;
+        // Units systemd has loaded, by object path.
+        std::map<std::string, Unit> loaded;
+        // Unit files that weren't loaded when they were last seen, by id.
+        // Ones loaded since show up in loaded as well.
+        std::map<std::string, Unit> files;
+    };
+
+    // Lists everything over the system bus right now. Throws
+    // ljh::unix::dbus::error.
+    Units list();
+
+    // Call start() before the io_context runs and stop() once it has
+    // stopped.
+    void start(asio::io_context& io_context);
+    void stop();
+
+    // The table as of the last signal, nullptr while it isn't being kept:
+    // systemd isn't running, the bus went away, or the first listing
+    // hasn't finished.
+    std::shared_ptr<const Units> units();
+}
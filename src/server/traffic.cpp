@@ -0,0 +1,337 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#include "traffic.hpp"
+#include "config.hpp"
+
+#include <map>
+#include <mutex>
+#include <limits>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <condition_variable>
+
+#include <ljh/system_info.hpp>
+#include <ljh/string_utils.hpp>
+
+#include <spdlog/spdlog.h>
+
+#if defined(LJH_TARGET_Windows)
+#include <winsock2.h>
+#include <iphlpapi.h>
+#include <netioapi.h>
+#elif defined(LJH_TARGET_Linux)
+#include <net/if_arp.h>
+#include "netlink.hpp"
+#endif
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    struct Counters
+    {
+        std::string name;
+        uint64_t bytes_rx;
+        uint64_t bytes_tx;
+    };
+
+    // The same adapters Info::Adapters lists.
+    std::vector<Counters> read_counters()
+    {
+        std::vector<Counters> counters;
+#if defined(LJH_TARGET_Windows)
+        MIB_IF_TABLE2* table = nullptr;
+        if (GetIfTable2(&table) != NO_ERROR)
+            return counters;
+
+        for (ULONG i = 0; i < table->NumEntries; i++)
+        {
+            auto& row = table->Table[i];
+            if (row.InterfaceAndOperStatusFlags.FilterInterface)
+                continue;
+            if (row.PhysicalMediumType != NdisPhysicalMediumNative802_11 && row.PhysicalMediumType != NdisPhysicalMediumWirelessLan && row.PhysicalMediumType != NdisPhysicalMedium802_3 && row.PhysicalMediumType != NdisPhysicalMediumUnspecified)
+                continue;
+            counters.push_back({ljh::convert_string(row.Alias), row.InOctets, row.OutOctets});
+        }
+        FreeMibTable(table);
+#elif defined(LJH_TARGET_Linux)
+        for (auto& link : Netlink::links())
+        {
+            if (link.type != ARPHRD_LOOPBACK)
+                counters.push_back({std::move(link.name), link.bytes_rx, link.bytes_tx});
+        }
+#endif
+        return counters;
+    }
+
+    // One adapter's samples. Only the sampling thread pushes, any number of
+    // threads may read at the same time.
+    class Ring
+    {
+        struct Slot
+        {
+            std::atomic<uint64_t> time    {0};
+            std::atomic<uint64_t> bytes_rx{0};
+            std::atomic<uint64_t> bytes_tx{0};
+            std::atomic<uint64_t> rx_rate {0};
+            std::atomic<uint64_t> tx_rate {0};
+            std::atomic<uint64_t> interval{0};
+        };
+
+        std::unique_ptr<Slot[]> slots;
+        std::size_t capacity;
+        // Samples the writer has started and finished writing. Slot i % capacity
+        // holds sample i once finished passes it, until started passes
+        // i + capacity and it is being overwritten.
+        std::atomic<uint64_t> started {0};
+        std::atomic<uint64_t> finished{0};
+
+    public:
+        explicit Ring(std::size_t capacity)
+            : slots(std::make_unique<Slot[]>(capacity)), capacity(capacity)
+        {}
+
+        void push(const Traffic::Sample& sample)
+        {
+            auto index = finished.load(std::memory_order_relaxed);
+            started.store(index + 1, std::memory_order_relaxed);
+            // Anyone who sees the new slot contents also sees started moved.
+            std::atomic_thread_fence(std::memory_order_release);
+
+            auto& slot = slots[index % capacity];
+            slot.time    .store(sample.time    , std::memory_order_relaxed);
+            slot.bytes_rx.store(sample.bytes_rx, std::memory_order_relaxed);
+            slot.bytes_tx.store(sample.bytes_tx, std::memory_order_relaxed);
+            slot.rx_rate .store(sample.rx_rate , std::memory_order_relaxed);
+            slot.tx_rate .store(sample.tx_rate , std::memory_order_relaxed);
+            slot.interval.store(sample.interval, std::memory_order_relaxed);
+
+            finished.store(index + 1, std::memory_order_release);
+        }
+
+        // The newest count samples, oldest first. Samples overwritten while
+        // they were being copied are left out.
+        std::vector<Traffic::Sample> read(std::size_t count) const
+        {
+            auto end = finished.load(std::memory_order_acquire);
+            auto begin = end - std::min<uint64_t>({end, count, capacity});
+
+            std::vector<Traffic::Sample> samples;
+            samples.reserve(end - begin);
+            for (auto index = begin; index < end; index++)
+            {
+                auto& slot = slots[index % capacity];
+                samples.push_back({
+                    slot.time    .load(std::memory_order_relaxed),
+                    slot.bytes_rx.load(std::memory_order_relaxed),
+                    slot.bytes_tx.load(std::memory_order_relaxed),
+                    slot.rx_rate .load(std::memory_order_relaxed),
+                    slot.tx_rate .load(std::memory_order_relaxed),
+                    slot.interval.load(std::memory_order_relaxed),
+                });
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (auto reused = started.load(std::memory_order_relaxed); reused > capacity && reused - capacity > begin)
+                samples.erase(samples.begin(), samples.begin() + std::min<uint64_t>(reused - capacity - begin, samples.size()));
+            return samples;
+        }
+    };
+
+    // Rings by adapter name. Replaced as a whole when adapters come or go,
+    // readers keep whichever table they loaded alive.
+    using Table = std::map<std::string, std::shared_ptr<Ring>, std::less<>>;
+
+    class Sampler
+    {
+        std::shared_ptr<const Table> table = std::make_shared<const Table>();
+
+        std::mutex lock;
+        std::condition_variable wake;
+        std::thread thread;
+        bool stopping = false;
+        std::atomic<bool> active{false};
+
+        // Last sample of each adapter, only touched by the sampling thread.
+        std::map<std::string, Traffic::Sample, std::less<>> previous;
+
+        void sample()
+        {
+            auto counters = read_counters();
+            auto now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count());
+
+            auto current = std::atomic_load(&table);
+            bool changed = counters.size() != current->size();
+            Table next;
+            for (auto& counter : counters)
+            {
+                auto ring = current->find(counter.name);
+                if (ring == current->end())
+                {
+                    changed = true;
+                    next.emplace(counter.name, std::make_shared<Ring>(std::max<std::size_t>(config.adapters.history, 2)));
+                }
+                else
+                {
+                    next.emplace(counter.name, ring->second);
+                }
+            }
+
+            decltype(previous) samples;
+            for (auto& counter : counters)
+            {
+                Traffic::Sample sample;
+                sample.time = now;
+                sample.bytes_rx = counter.bytes_rx;
+                sample.bytes_tx = counter.bytes_tx;
+
+                if (auto last = previous.find(counter.name); last != previous.end() && last->second.time < now)
+                {
+                    // Counters going backwards were reset (the driver was
+                    // reloaded, say), there is no rate to give until the next one.
+                    auto rate = [elapsed = static_cast<double>(now - last->second.time)](uint64_t from, uint64_t to) {
+                        return to >= from ? static_cast<uint64_t>((to - from) * 1e9 / elapsed) : 0;
+                    };
+                    sample.rx_rate = rate(last->second.bytes_rx, counter.bytes_rx);
+                    sample.tx_rate = rate(last->second.bytes_tx, counter.bytes_tx);
+                    sample.interval = now - last->second.time;
+                }
+
+                next[counter.name]->push(sample);
+                samples.insert_or_assign(counter.name, sample);
+            }
+            previous = std::move(samples);
+
+            if (changed)
+                std::atomic_store(&table, std::shared_ptr<const Table>{std::make_shared<Table>(std::move(next))});
+        }
+
+        void run()
+        {
+            auto next = clock::now();
+            std::unique_lock guard{lock};
+            while (!stopping)
+            {
+                guard.unlock();
+                try
+                {
+                    sample();
+                }
+                catch (const std::exception& e)
+                {
+                    spdlog::error("Sampling adapters failed: {}", e.what());
+                }
+                guard.lock();
+
+                // Samples stay on a fixed schedule, but one that fell behind
+                // (the machine was suspended, say) doesn't try to catch up.
+                next = std::max(next + config.adapters.interval, clock::now());
+                wake.wait_until(guard, next, [this] { return stopping; });
+            }
+        }
+
+        std::shared_ptr<Ring> find(std::string_view adapter) const
+        {
+            auto current = std::atomic_load(&table);
+            if (auto ring = current->find(adapter); ring != current->end())
+                return ring->second;
+            return nullptr;
+        }
+
+    public:
+        ~Sampler()
+        {
+            stop();
+        }
+
+        void start()
+        {
+            if (config.adapters.interval.count() == 0 || thread.joinable())
+                return;
+            stopping = false;
+            thread = std::thread{&Sampler::run, this};
+            active = true;
+        }
+
+        void stop()
+        {
+            if (!thread.joinable())
+                return;
+            {
+                std::lock_guard guard{lock};
+                stopping = true;
+            }
+            wake.notify_all();
+            thread.join();
+            active = false;
+        }
+
+        bool running() const
+        {
+            return active;
+        }
+
+        std::optional<Traffic::Sample> latest(std::string_view adapter) const
+        {
+            if (auto ring = find(adapter))
+            {
+                if (auto samples = ring->read(1); !samples.empty())
+                    return samples.back();
+            }
+            return std::nullopt;
+        }
+
+        std::vector<Traffic::Sample> history(std::string_view adapter, uint64_t since) const
+        {
+            std::vector<Traffic::Sample> samples;
+            if (auto ring = find(adapter))
+                samples = ring->read(std::numeric_limits<std::size_t>::max());
+            samples.erase(samples.begin(), std::find_if(samples.begin(), samples.end(), [since](auto& sample) { return sample.time > since; }));
+            return samples;
+        }
+
+        std::vector<std::string> adapters() const
+        {
+            std::vector<std::string> names;
+            for (auto& [name, ring] : *std::atomic_load(&table))
+                names.push_back(name);
+            return names;
+        }
+    };
+
+    Sampler sampler;
+}
+
+void Traffic::start()
+{
+    sampler.start();
+}
+
+void Traffic::stop()
+{
+    sampler.stop();
+}
+
+bool Traffic::running()
+{
+    return sampler.running();
+}
+
+std::optional<Traffic::Sample> Traffic::latest(std::string_view adapter)
+{
+    return sampler.latest(adapter);
+}
+
+std::vector<Traffic::Sample> Traffic::history(std::string_view adapter, uint64_t since)
+{
+    return sampler.history(adapter, since);
+}
+
+std::vector<std::string> Traffic::adapters()
+{
+    return sampler.adapters();
+}
@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2021 Jared Irwin <jrairwin@sympatico.ca>
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+// Samples every adapter's byte counters on its own thread at the interval
+// set under [adapters], keeping the last few minutes of them per adapter.
+// Rates are worked out once per sample, so every client sees the same ones
+// however often or rarely it polls, and reading them does no I/O.
+//
+// Each adapter's history is a ring written only by the sampling thread.
+// Readers copy out of it without taking a lock and drop whatever was
+// overwritten while they were copying.
+namespace Traffic
+{
+    struct Sample
+    {
+        uint64_t time     = 0; // steady_clock nanoseconds, like Adapter::time
+        uint64_t bytes_rx = 0;
+        uint64_t bytes_tx = 0;
+        uint64_t rx_rate  = 0; // Bytes per second since the sample before
+        uint64_t tx_rate  = 0;
+        uint64_t interval = 0; // Nanoseconds since the sample before, 0 for the first
+    };
+
+    void start();
+    void stop();
+
+    // Whether samples are being taken, [adapters] interval=0 turns it off.
+    bool running();
+
+    // Newest sample of the adapter, nullopt before it has been sampled.
+    std::optional<Sample> latest(std::string_view adapter);
+
+    // Samples newer than since (0 for all of them), oldest first.
+    std::vector<Sample> history(std::string_view adapter, uint64_t since = 0);
+
+    // Every adapter currently being sampled.
+    std::vector<std::string> adapters();
+}
@@ -7,7 +7,11 @@
 
 #undef interface
 
-#include <regex>
+#if defined(LJH_TARGET_Linux)
+#include "packages.hpp"
+#include <future>
+#include <spdlog/spdlog.h>
+#endif
 
 #if defined(LJH_TARGET_Windows)
 #include <ljh/windows/com_bstr.hpp>
@@ -43,70 +47,50 @@ ljh::expected<Bakaneko::Updates, Errors> Info::Updates(const Fields &fields)
         update.name = (ljh::convert_string(update_name));
     }
 #elif defined(LJH_TARGET_Linux)
-    auto run = [&updates](const std::string &command, const std::string &flags, bool (*decode)(Bakaneko::Update &, std::string)) -> bool {
-        auto [exit_code, std_out] = exec(command + ' ' + flags);
-        if (exit_code == 0)
+    // Reads the native database, falling back to the command when it can't.
+    auto collect = [](const Packages::Manager *manager) {
+        try
         {
-            auto packages = ljh::split(std_out, '\n');
-            for (auto &package : packages)
-            {
-                if (package.empty())
-                    continue;
-
-                Bakaneko::Update update;
-                if (decode(update, package))
-                    updates.updates.emplace_back(std::move(update));
-            }
-
-            return true;
+            if (auto native = manager->read(); native)
+                return std::move(*native);
+        }
+        catch (const std::exception &e)
+        {
+            spdlog::warn("Couldn't read the {} database: {}", manager->name, e.what());
         }
-        return false;
-    };
-
-    auto pacman_decode = [](Bakaneko::Update &update, std::string package) {
-        size_t space = package.find(' '), pre_space = 0;
-        update.name = (package.substr(pre_space, space - pre_space));
-
-        pre_space = space;
-        space = package.find(' ', space + 1);
-        update.old_version = (package.substr(pre_space, space - pre_space));
-
-        pre_space = space + 4;
-        update.new_version = (package.substr(pre_space));
 
-        return true;
-    };
-    auto apt_decode = [](Bakaneko::Update &update, std::string package) {
-        auto info = ljh::split(package, ' ');
-        if (info.size() != 6)
-            return false;
+        std::vector<Bakaneko::Update> found;
+        auto [exit_code, std_out] = exec(std::string{manager->command});
+        if (exit_code != 0)
+            return found;
 
-        update.name = (info[0].substr(0, info[0].find('/')));
-        update.old_version = (info[5].substr(0, info[5].size() - 1));
-        update.new_version = (info[1]);
+        std::string_view lines = std_out;
+        while (!lines.empty())
+        {
+            auto eol = lines.find('\n');
+            auto line = lines.substr(0, eol);
+            lines.remove_prefix(eol == std::string_view::npos ? lines.size() : eol + 1);
 
-        return true;
+            Bakaneko::Update update;
+            if (!line.empty() && manager->decode(update, line))
+                found.push_back(std::move(update));
+        }
+        return found;
     };
-    auto apk_decode = [](Bakaneko::Update &update, std::string package) {
-        auto info = ljh::split(package, '=');
-        if (info.size() != 2)
-            return false;
-
-        std::regex version(R"((.*)-(\d.*?-r\d))");
-        std::smatch sm;
-        if (!std::regex_search(info[0], sm, version))
-            return false;
 
-        update.name = (sm[1].str());
-        update.old_version = (sm[2].str());
-        update.new_version = (info[1]);
+    // Hosts rarely have more than one, the others get a thread each.
+    auto &managers = Packages::detected();
+    std::vector<std::future<std::vector<Bakaneko::Update>>> others;
+    for (std::size_t i = 1; i < managers.size(); i++)
+        others.push_back(std::async(std::launch::async, collect, managers[i]));
 
-        return true;
+    auto append = [&updates](std::vector<Bakaneko::Update> &&found) {
+        std::move(found.begin(), found.end(), std::back_inserter(updates.updates));
     };
-
-    run("pacman", "-Qu", pacman_decode);
-    run("apt", "list --upgradable", apt_decode);
-    run("apk", "version -v -l '<'", apk_decode);
+    if (!managers.empty())
+        append(collect(managers.front()));
+    for (auto &other : others)
+        append(other.get());
 #else
     return ljh::unexpected{Errors::NotImplemented};
 #endif